@@ -0,0 +1,599 @@
+#include <map>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <type_traits>
+#include "include/rbt.h"
+#include "include/compactrbt.h"
+#include "include/frozenrbt.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+using namespace std;
+using namespace chrono;
+
+// every SAMPLE_EVERY-th operation is timed on its own for the latency percentiles
+#define SAMPLE_EVERY 8
+
+// number of elements visited by one range scan
+#define SCAN_LENGTH 100
+
+// skew of the Zipfian key stream, the value used by YCSB
+#define ZIPF_THETA 0.99
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              TREE BENCHMARK                                             ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Hardware counters of the calling thread, read through perf_event_open. Counters the kernel or the machine does
+ * not provide (no PMU in a virtual machine, a restrictive perf_event_paranoid) are left closed and reported as
+ * unavailable, the benchmark itself runs either way.
+ */
+struct perfCounters
+{
+    static const int COUNT = 3;
+    int fds[COUNT];
+    unsigned long long values[COUNT];
+
+    perfCounters()
+    {
+        unsigned long long configs[COUNT] = {
+#ifdef __linux__
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_INSTRUCTIONS
+#endif
+        };
+
+        for (int i = 0; i < COUNT; i++)
+        {
+            fds[i] = -1;
+            values[i] = 0;
+#ifdef __linux__
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[i];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+        }
+    }
+
+    ~perfCounters()
+    {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++)
+            if (fds[i] >= 0)
+                close(fds[i]);
+#endif
+    }
+
+    bool available(int i) const
+    {
+        return fds[i] >= 0;
+    }
+
+    void start()
+    {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (fds[i] >= 0)
+            {
+                ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+                ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void stop()
+    {
+#ifdef __linux__
+        for (int i = 0; i < COUNT; i++)
+        {
+            if (fds[i] >= 0)
+            {
+                ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+                if (read(fds[i], &values[i], sizeof(values[i])) != sizeof(values[i]))
+                    values[i] = 0;
+            }
+        }
+#endif
+    }
+};
+
+/**
+ * Bytes currently handed out by malloc, including blocks it serves with mmap. Differences of this value give the
+ * memory a structure really takes, allocator headers and slack included. Returns 0 outside of glibc.
+ */
+size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Zipfian generator over the ranks 0 .. n - 1, rank 0 being the most popular, following Gray et al., "Quickly
+ * generating billion-record synthetic databases" as used by YCSB.
+ */
+struct zipfian
+{
+    size_t n;
+    double alpha, zetan, eta, theta;
+    mt19937_64 rng;
+
+    zipfian(size_t n, double theta, unsigned long long seed) : n(n), theta(theta), rng(seed)
+    {
+        double zeta2 = 1.0 + pow(0.5, theta);
+
+        zetan = 0;
+        for (size_t i = 1; i <= n; i++)
+            zetan += 1.0 / pow((double) i, theta);
+
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    size_t next()
+    {
+        double u = (double) (rng() >> 11) / (double) (1ull << 53);
+        double uz = u * zetan;
+
+        if (uz < 1.0)
+            return 0;
+        if (uz < 1.0 + pow(0.5, theta))
+            return 1;
+
+        return min(n - 1, (size_t) (n * pow(eta * u - eta + 1.0, alpha)));
+    }
+};
+
+/**
+ * Measurement of one workload on one structure.
+ */
+struct result
+{
+    string structure, workload, stream;
+    size_t size, ops;
+    double nsPerOp, p50, p99, bytesPerElement;
+    bool counted[perfCounters::COUNT];
+    double perOp[perfCounters::COUNT];
+};
+
+/**
+ * The operations of one benchmark run. The key streams are generated up front from fixed seeds so every structure
+ * sees exactly the same sequence and no generator runs inside the timed loops.
+ */
+struct workloadSet
+{
+    string stream;
+    vector<unsigned long long> order;    // insertion and deletion order
+    vector<unsigned long long> queries;  // keys for searches, range scan starts and mixed operations
+    vector<unsigned long long> fresh;    // keys inserted by the mixed workload
+    vector<unsigned char> kinds;         // mixed workload operation, 0 search, 1 insert, 2 delete
+};
+
+/**
+ * Adapters presenting each structure through the same five calls.
+ */
+struct rbtAdapter
+{
+    static const char* name() { return "RBT"; }
+    RBTree<unsigned long long, unsigned long long> tree;
+
+    void insert(unsigned long long key) { tree.insert(key, key); }
+    bool erase(unsigned long long key) { return tree.del(key); }
+    unsigned long long search(unsigned long long key) { return tree.search(key)->data; }
+    unsigned long long scan(unsigned long long key)
+    {
+        unsigned long long sum = 0;
+        RBTree<unsigned long long, unsigned long long>::iterator it = tree.lower_bound(key), last = tree.end();
+        for (int i = 0; i < SCAN_LENGTH && it != last; i++, ++it)
+            sum += it->data;
+        return sum;
+    }
+};
+
+struct compactAdapter
+{
+    static const char* name() { return "CompactRBT"; }
+    CompactRBT<unsigned long long> tree;
+
+    void insert(unsigned long long key) { tree.insert(key, nullptr); }
+    bool erase(unsigned long long key) { return tree.del(key); }
+    unsigned long long search(unsigned long long key) { return tree.contains(key); }
+};
+
+struct mapAdapter
+{
+    static const char* name() { return "std::map"; }
+    map<unsigned long long, unsigned long long> tree;
+
+    void insert(unsigned long long key) { tree.emplace(key, key); }
+    bool erase(unsigned long long key) { return tree.erase(key) != 0; }
+    unsigned long long search(unsigned long long key)
+    {
+        map<unsigned long long, unsigned long long>::iterator it = tree.find(key);
+        return it == tree.end() ? 0 : it->second;
+    }
+    unsigned long long scan(unsigned long long key)
+    {
+        unsigned long long sum = 0;
+        map<unsigned long long, unsigned long long>::iterator it = tree.lower_bound(key);
+        for (int i = 0; i < SCAN_LENGTH && it != tree.end(); i++, ++it)
+            sum += it->second;
+        return sum;
+    }
+};
+
+struct frozenAdapter
+{
+    static const char* name() { return "FrozenRBT"; }
+    FrozenRBT<unsigned long long, unsigned long long> tree;
+
+    unsigned long long search(unsigned long long key)
+    {
+        const unsigned long long* data = tree.search(key);
+        return data == nullptr ? 0 : *data;
+    }
+    unsigned long long scan(unsigned long long key)
+    {
+        unsigned long long sum = 0;
+        for (size_t i = tree.lower_bound(key).position(), last = min(tree.size(), i + SCAN_LENGTH); i < last; i++)
+            sum += tree.valueAt(i);
+        return sum;
+    }
+};
+
+volatile unsigned long long sink;
+vector<result> results;
+
+/**
+ * Prints a result as one row of the table and keeps it for the JSON output.
+ */
+void record(const result& r)
+{
+    cout << left << setw(12) << r.structure << setw(14) << r.workload << setw(12) << r.stream << right
+         << setw(11) << r.size << fixed << setprecision(1) << setw(11) << r.nsPerOp << setw(10) << r.p50
+         << setw(10) << r.p99 << setw(9) << r.bytesPerElement;
+    if (r.counted[0])
+        cout << setw(12) << r.perOp[0];
+    cout << endl;
+
+    results.push_back(r);
+}
+
+/**
+ * Runs op for every index in [0, ops) and returns the mean cost per operation, the 50th and 99th percentile of the
+ * individually timed operations and the hardware counters per operation.
+ */
+template <class Op>
+result measure(const char* structure, const char* workload, const workloadSet& set, size_t size, size_t ops,
+    double bytesPerElement, Op op)
+{
+    perfCounters counters;
+    vector<double> samples;
+    unsigned long long acc = 0;
+
+    samples.reserve(ops / SAMPLE_EVERY + 1);
+    counters.start();
+    steady_clock::time_point start = steady_clock::now();
+
+    for (size_t i = 0; i < ops; i++)
+    {
+        if (i % SAMPLE_EVERY == 0)
+        {
+            steady_clock::time_point before = steady_clock::now();
+            acc += op(i);
+            samples.push_back(duration<double, nano>(steady_clock::now() - before).count());
+        }
+        else
+            acc += op(i);
+    }
+
+    double total = duration<double, nano>(steady_clock::now() - start).count();
+    counters.stop();
+    sink = sink + acc;
+
+    result r;
+    r.structure = structure;
+    r.workload = workload;
+    r.stream = set.stream;
+    r.size = size;
+    r.ops = ops;
+    r.nsPerOp = ops ? total / ops : 0;
+    r.bytesPerElement = bytesPerElement;
+    r.p50 = r.p99 = 0;
+
+    if (!samples.empty())
+    {
+        nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+        r.p50 = samples[samples.size() / 2];
+        nth_element(samples.begin(), samples.begin() + samples.size() * 99 / 100, samples.end());
+        r.p99 = samples[samples.size() * 99 / 100];
+    }
+
+    for (int i = 0; i < perfCounters::COUNT; i++)
+    {
+        r.counted[i] = counters.available(i);
+        r.perOp[i] = ops ? (double) counters.values[i] / ops : 0;
+    }
+
+    return r;
+}
+
+/**
+ * Generates the key streams of one run. The element set is always n distinct random keys; the stream decides the
+ * order they are inserted and deleted in and which keys the queries hit. Uniform inserts in random order and queries
+ * uniformly, sequential and reverse go through the keys in ascending and descending order, and Zipfian inserts in
+ * random order but concentrates the queries on a few popular keys.
+ */
+workloadSet makeStream(const string& stream, const vector<unsigned long long>& keys, size_t queryCount)
+{
+    workloadSet set;
+    mt19937_64 rng(7);
+    size_t n = keys.size();
+
+    set.stream = stream;
+    set.order = keys;
+    if (stream == "sequential" || stream == "reverse")
+        sort(set.order.begin(), set.order.end());
+    if (stream == "reverse")
+        reverse(set.order.begin(), set.order.end());
+
+    zipfian zipf(stream == "zipfian" ? n : 1, ZIPF_THETA, 11);
+
+    for (size_t i = 0; i < queryCount; i++)
+    {
+        if (stream == "uniform")
+            set.queries.push_back(keys[rng() % n]);
+        else if (stream == "zipfian")
+            set.queries.push_back(keys[zipf.next()]);
+        else
+            set.queries.push_back(set.order[i % n]);
+
+        unsigned kind = rng() % 10;
+        set.kinds.push_back(kind < 8 ? 0 : kind == 8 ? 1 : 2);
+        set.fresh.push_back(rng());
+    }
+
+    return set;
+}
+
+/**
+ * Runs the insert, search, range scan, mixed and delete workloads, in that order, on a freshly constructed
+ * structure of type A. Structures without range scans pass scans as false.
+ */
+template <class A, bool scans>
+struct runner
+{
+    static void run(const workloadSet& set, size_t queryCount);
+};
+
+template <class A>
+unsigned long long scanOf(A& a, unsigned long long key, std::true_type)
+{
+    return a.scan(key);
+}
+
+template <class A>
+unsigned long long scanOf(A&, unsigned long long, std::false_type)
+{
+    return 0;
+}
+
+template <class A, bool scans>
+void runner<A, scans>::run(const workloadSet& set, size_t queryCount)
+{
+    size_t n = set.order.size();
+    size_t heapBefore = heapInUse();
+    A* a = new A();
+
+    result inserted = measure(A::name(), "insert", set, n, n, 0, [&](size_t i) {
+        a->insert(set.order[i]);
+        return 0ull;
+    });
+
+    double bytes = (double) (heapInUse() - heapBefore) / n;
+    inserted.bytesPerElement = bytes;
+    record(inserted);
+
+    record(measure(A::name(), "search", set, n, queryCount, bytes, [&](size_t i) {
+        return a->search(set.queries[i]);
+    }));
+
+    if (scans)
+    {
+        record(measure(A::name(), "range-scan", set, n, queryCount / 10, bytes, [&](size_t i) {
+            return scanOf(*a, set.queries[i], std::integral_constant<bool, scans>());
+        }));
+    }
+
+    record(measure(A::name(), "mixed", set, n, queryCount, bytes, [&](size_t i) {
+        if (set.kinds[i] == 0)
+            return a->search(set.queries[i]);
+        if (set.kinds[i] == 1)
+        {
+            a->insert(set.fresh[i]);
+            return 0ull;
+        }
+        return (unsigned long long) a->erase(set.queries[i]);
+    }));
+
+    // the mixed workload added and removed keys, put the original set back so deletion removes exactly n keys
+    delete a;
+    a = new A();
+    for (size_t i = 0; i < n; i++)
+        a->insert(set.order[i]);
+
+    record(measure(A::name(), "delete", set, n, n, bytes, [&](size_t i) {
+        return (unsigned long long) a->erase(set.order[i]);
+    }));
+    delete a;
+}
+
+/**
+ * Builds a frozen copy of the set and runs the read only workloads on it.
+ */
+void runFrozen(const workloadSet& set, size_t queryCount)
+{
+    size_t n = set.order.size();
+    frozenAdapter* f = new frozenAdapter();
+
+    {
+        RBTree<unsigned long long, unsigned long long> tree;
+        for (size_t i = 0; i < n; i++)
+            tree.insert(set.order[i], set.order[i]);
+
+        size_t heapBefore = heapInUse();
+        f->tree = tree.freeze();
+        size_t heapAfter = heapInUse();
+
+        double bytes = (double) (heapAfter - heapBefore) / n;
+
+        record(measure(frozenAdapter::name(), "search", set, n, queryCount, bytes, [&](size_t i) {
+            return f->search(set.queries[i]);
+        }));
+        record(measure(frozenAdapter::name(), "range-scan", set, n, queryCount / 10, bytes, [&](size_t i) {
+            return f->scan(set.queries[i]);
+        }));
+    }
+
+    delete f;
+}
+
+/**
+ * Writes every result as one JSON document.
+ */
+bool writeJson(const string& path, unsigned long long seed)
+{
+    FILE* out = fopen(path.c_str(), "w");
+    if (out == nullptr)
+        return false;
+
+    const char* counterNames[perfCounters::COUNT] = {"cache_misses_per_op", "branch_misses_per_op",
+        "instructions_per_op"};
+
+    fprintf(out, "{\n  \"benchmark\": \"RBT_BENCH\",\n  \"seed\": %llu,\n  \"sample_every\": %d,\n", seed,
+        SAMPLE_EVERY);
+    fprintf(out, "  \"scan_length\": %d,\n  \"zipf_theta\": %.2f,\n  \"results\": [\n", SCAN_LENGTH, ZIPF_THETA);
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const result& r = results[i];
+        fprintf(out, "    {\"structure\": \"%s\", \"workload\": \"%s\", \"stream\": \"%s\", \"size\": %zu, "
+            "\"ops\": %zu, \"ns_per_op\": %.2f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"bytes_per_element\": %.2f",
+            r.structure.c_str(), r.workload.c_str(), r.stream.c_str(), r.size, r.ops, r.nsPerOp, r.p50, r.p99,
+            r.bytesPerElement);
+
+        for (int c = 0; c < perfCounters::COUNT; c++)
+        {
+            if (r.counted[c])
+                fprintf(out, ", \"%s\": %.3f", counterNames[c], r.perOp[c]);
+            else
+                fprintf(out, ", \"%s\": null", counterNames[c]);
+        }
+
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+
+    fprintf(out, "  ]\n}\n");
+    return fclose(out) == 0;
+}
+
+/**
+ * Benchmarks RBT, CompactRBT, FrozenRBT and std::map on insert, search, range scan, mixed (80% searches, 10%
+ * inserts, 10% deletes) and delete workloads, over uniform, sequential, reverse and Zipfian key streams, for sizes
+ * growing tenfold from the smallest to the largest size. The frozen tree only takes part in the read only
+ * workloads and CompactRBT, which has no ordered iteration by count, skips the range scans. All keys come from
+ * fixed seeds. Results are printed as a table and, if a path is given, written as JSON.
+ *
+ * Usage: RBT_BENCH [smallest size] [largest size] [json output] [queries per workload]
+ *
+ * @param int
+ * @param char**
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    size_t smallest = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000;
+    size_t largest = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+    string jsonPath = argc > 3 ? argv[3] : "";
+    size_t queryCount = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1000000;
+    const unsigned long long seed = 42;
+
+    if (smallest < 1)
+        smallest = 1;
+
+    const char* streams[] = {"uniform", "sequential", "reverse", "zipfian"};
+
+    cout << left << setw(12) << "structure" << setw(14) << "workload" << setw(12) << "stream" << right
+         << setw(11) << "size" << setw(11) << "ns/op" << setw(10) << "p50" << setw(10) << "p99" << setw(9)
+         << "B/elem" << setw(12) << "misses/op" << endl;
+
+    for (size_t n = smallest; n <= largest; n *= 10)
+    {
+        mt19937_64 rng(seed);
+        vector<unsigned long long> keys(n);
+
+        for (size_t i = 0; i < n; i++)
+            keys[i] = rng();
+
+        // drop the astronomically unlikely duplicates so every structure holds the same n keys
+        vector<unsigned long long> sorted = keys;
+        sort(sorted.begin(), sorted.end());
+        if (adjacent_find(sorted.begin(), sorted.end()) != sorted.end())
+        {
+            sorted.erase(unique(sorted.begin(), sorted.end()), sorted.end());
+            keys = sorted;
+            shuffle(keys.begin(), keys.end(), rng);
+        }
+
+        for (const char* stream : streams)
+        {
+            workloadSet set = makeStream(stream, keys, queryCount);
+
+            runner<rbtAdapter, true>::run(set, queryCount);
+            runner<compactAdapter, false>::run(set, queryCount);
+            runner<mapAdapter, true>::run(set, queryCount);
+            runFrozen(set, queryCount);
+        }
+
+        if (n > largest / 10)
+            break;
+    }
+
+    if (!jsonPath.empty() && !writeJson(jsonPath, seed))
+    {
+        cerr << "could not write " << jsonPath << endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -9,7 +9,7 @@ using namespace std;
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * Main controller for demoing a simple RBT class implementation which holds int types as its data.
+ * Main controller for demoing a simple RBTree class implementation which holds int values inline as its data.
  * 
  * @param int
  * @param char**
@@ -17,7 +17,7 @@ using namespace std;
  */
 int main(int argc, char** argv)
 {
-    RBT<int> tree = RBT<int>();
+    RBTree<unsigned long long, int> tree = RBTree<unsigned long long, int>();
     
     cout << "Enter 1 to insert a new node into the tree." << endl;
     cout << "Enter 2 to delete a node from the tree." << endl;
@@ -43,8 +43,8 @@ int main(int argc, char** argv)
             if (key == -1)
                 break;
             
-            // The tree uses the key for its key and data fields. The trees' generics are for the data portion of the node.
-            tree.insert(key, &key); //(key, data)
+            // The tree uses the key for its key and data fields. The value is copied into the node.
+            tree.insert(key, key); //(key, data)
             tree.prettyPrint();
         }
         else if (key == 2) // deletion selection
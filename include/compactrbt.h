@@ -0,0 +1,92 @@
+#ifndef COMPACTRBT_H
+#define  COMPACTRBT_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "rbt.h"
+
+// the color is kept in the top bit of the left link, which leaves 31 bits for node indices
+#define COMPACT_COLOR_BIT 0x80000000u
+#define COMPACT_MAX_NODES 0x7fffffffu
+
+// upper bound on the number of ancestors kept while rebalancing, a red black tree of 2^31 nodes is at most 62 high
+#define COMPACT_MAX_DEPTH 96
+
+/**
+ * A compact red black tree header file containing all appropriate declarations.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * Node of the compact tree. The left and right links are 32 bit indices into the node array of the tree and the
+ * color lives in the top bit of the left link; there is no parent index, the ancestors needed for rebalancing are kept on a stack
+ * while descending. Index 0 is the black sentinel, so a node with a pointer payload takes 24 bytes instead of the
+ * 48 bytes of rbNode.
+ */
+template <typename T>
+struct rbCompactNode
+{
+    std::uint32_t links[2];
+    unsigned long long key;
+    T* data;
+
+    std::uint32_t left() const;
+    std::uint32_t right() const;
+    char rbColor() const;
+};
+
+/**
+ * Red black tree which stores its nodes in one contiguous array and links them by 32 bit index. Searching,
+ * insertion and deletion behave like in RBT, including duplicate keys which go to the left, but since nodes may be
+ * moved when the array grows or when a node with two children is deleted, nodes are only handed out for the
+ * duration of a callback. Freed slots are reused by later insertions. At most COMPACT_MAX_NODES nodes fit in one
+ * tree.
+ */
+template <class T>
+class CompactRBT
+{
+    public:
+        CompactRBT();
+        void clear();
+        bool isEmpty();
+        std::size_t size();
+        template <class F>
+        void forEach(F fn);
+        std::uint32_t getRoot();
+        void reserve(std::size_t n);
+        std::size_t memoryUsage();
+        T* search(unsigned long long key);
+        bool del(unsigned long long key);
+        bool contains(unsigned long long key);
+        void insert(unsigned long long key, T* data);
+        const rbCompactNode<T>& getNode(std::uint32_t index);
+        template <class F>
+        void forEachInRange(unsigned long long lo, unsigned long long hi, F fn);
+
+    private:
+        std::uint32_t root;
+        std::uint32_t freeList;
+        std::size_t nodeCount;
+        std::vector<rbCompactNode<T>> nodes;
+
+        std::uint32_t allocate();
+        bool isRed(std::uint32_t n);
+        std::uint32_t left(std::uint32_t n);
+        void deallocate(std::uint32_t n);
+        std::uint32_t psearch(unsigned long long key);
+        void setColor(std::uint32_t n, char color);
+        void setLeft(std::uint32_t n, std::uint32_t child);
+        void leftRotate(std::uint32_t x, std::uint32_t parent);
+        void rightRotate(std::uint32_t y, std::uint32_t parent);
+        void pdelFixup(std::uint32_t x, std::uint32_t* path, int depth);
+        void pinsertFixup(std::uint32_t z, std::uint32_t* path, int depth);
+        void replaceChild(std::uint32_t parent, std::uint32_t child, std::uint32_t replacement);
+};
+
+// Include templated implementation file as it is necessary to present during compile time
+#include "compactrbt.tpp"
+
+#endif
@@ -0,0 +1,679 @@
+#include "compactrbt.h"
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * A compact red black tree template implementation file. The algorithms are the ones of RBT, taken from
+ * 'Introduction to Algorithms', with every parent lookup answered by the stack of ancestors recorded on the way
+ * down instead of a parent pointer.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                             PUBLIC INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates an empty tree whose node array only holds the black sentinel.
+ *
+ * @return this
+ */
+template <class T>
+CompactRBT<T>::CompactRBT()
+{
+    clear();
+}
+
+/**
+ * Removes every element and returns the node array to the system.
+ *
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::clear()
+{
+    std::vector<rbCompactNode<T>> empty(1);
+    empty[0].key = 0;
+    empty[0].data = nullptr;
+    empty[0].links[0] = COMPACT_COLOR_BIT;
+    empty[0].links[1] = 0;
+
+    nodes.swap(empty);
+    root = 0;
+    freeList = 0;
+    nodeCount = 0;
+}
+
+/**
+ * Returns true if the tree holds no elements.
+ *
+ * @return bool
+ */
+template <class T>
+bool CompactRBT<T>::isEmpty()
+{
+    return nodeCount == 0;
+}
+
+/**
+ * Returns the number of elements in the tree.
+ *
+ * @return size_t
+ */
+template <class T>
+std::size_t CompactRBT<T>::size()
+{
+    return nodeCount;
+}
+
+/**
+ * Calls fn with every node whose key lies in [lo, hi), in key order. The tree must not be modified from within fn.
+ *
+ * @param unsigned long long
+ * @param unsigned long long
+ * @param F
+ * @return void
+ */
+template <class T>
+template <class F>
+void CompactRBT<T>::forEachInRange(unsigned long long lo, unsigned long long hi, F fn)
+{
+    std::uint32_t path[COMPACT_MAX_DEPTH];
+    int depth = 0;
+
+    // keep every node at which the search for lo turns left, those are the ancestors still to be visited
+    for (std::uint32_t x = root; x != 0;)
+    {
+        if (nodes[x].key >= lo)
+        {
+            path[depth++] = x;
+            x = left(x);
+        }
+        else
+            x = nodes[x].links[1];
+    }
+
+    while (depth > 0)
+    {
+        std::uint32_t x = path[--depth];
+
+        if (nodes[x].key >= hi)
+            return;
+
+        fn(&nodes[x]);
+
+        for (x = nodes[x].links[1]; x != 0; x = left(x))
+            path[depth++] = x;
+    }
+}
+
+/**
+ * Calls fn with every node in key order. The tree must not be modified from within fn.
+ *
+ * @param F
+ * @return void
+ */
+template <class T>
+template <class F>
+void CompactRBT<T>::forEach(F fn)
+{
+    std::uint32_t path[COMPACT_MAX_DEPTH];
+    int depth = 0;
+
+    for (std::uint32_t x = root; x != 0; x = left(x))
+        path[depth++] = x;
+
+    while (depth > 0)
+    {
+        std::uint32_t x = path[--depth];
+
+        fn(&nodes[x]);
+
+        for (x = nodes[x].links[1]; x != 0; x = left(x))
+            path[depth++] = x;
+    }
+}
+
+/**
+ * Returns the index of the root node, 0 when the tree is empty.
+ *
+ * @return uint32_t
+ */
+template <class T>
+std::uint32_t CompactRBT<T>::getRoot()
+{
+    return root;
+}
+
+/**
+ * Makes room for n elements in the node array so that the next n insertions do not move it.
+ *
+ * @param size_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::reserve(std::size_t n)
+{
+    nodes.reserve(nodeCount + n + 1);
+}
+
+/**
+ * Returns the number of bytes held by the node array, including unused capacity and free slots.
+ *
+ * @return size_t
+ */
+template <class T>
+std::size_t CompactRBT<T>::memoryUsage()
+{
+    return nodes.capacity() * sizeof(rbCompactNode<T>);
+}
+
+/**
+ * Returns the data stored with key, or nullptr if the key is not present.
+ *
+ * @param unsigned long long
+ * @return T*
+ */
+template <class T>
+T* CompactRBT<T>::search(unsigned long long key)
+{
+    std::uint32_t x = psearch(key);
+
+    if (x == 0)
+        return nullptr;
+    return nodes[x].data;
+}
+
+/**
+ * Deletes one element holding key and returns false if the key is not present. A node with two children takes
+ * over the key and data of its successor, whose slot is then removed instead, so no parent has to be relinked
+ * further up than the successor.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T>
+bool CompactRBT<T>::del(unsigned long long key)
+{
+    std::uint32_t path[COMPACT_MAX_DEPTH];
+    int depth = 0;
+    std::uint32_t z = root;
+
+    while (z != 0 && nodes[z].key != key)
+    {
+        path[depth++] = z;
+        z = key < nodes[z].key ? left(z) : nodes[z].links[1];
+    }
+
+    if (z == 0)
+        return false;
+
+    std::uint32_t y = z;
+
+    if (left(z) != 0 && nodes[z].links[1] != 0)
+    {
+        path[depth++] = z;
+
+        for (y = nodes[z].links[1]; left(y) != 0; y = left(y))
+            path[depth++] = y;
+
+        nodes[z].key = nodes[y].key;
+        nodes[z].data = nodes[y].data;
+    }
+
+    std::uint32_t x = left(y) != 0 ? left(y) : nodes[y].links[1];
+    std::uint32_t parent = depth > 0 ? path[depth - 1] : 0;
+
+    replaceChild(parent, y, x);
+
+    if (!isRed(y))
+        pdelFixup(x, path, depth);
+
+    deallocate(y);
+    nodeCount--;
+    return true;
+}
+
+/**
+ * Returns true if key is present.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T>
+bool CompactRBT<T>::contains(unsigned long long key)
+{
+    return psearch(key) != 0;
+}
+
+/**
+ * Inserts key and data, equal keys go to the left like in RBT.
+ *
+ * @param unsigned long long
+ * @param T*
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::insert(unsigned long long key, T* data)
+{
+    std::uint32_t path[COMPACT_MAX_DEPTH];
+    int depth = 0;
+
+    for (std::uint32_t x = root; x != 0; x = key <= nodes[x].key ? left(x) : nodes[x].links[1])
+        path[depth++] = x;
+
+    std::uint32_t z = allocate();
+    nodes[z].key = key;
+    nodes[z].data = data;
+    nodes[z].links[0] = 0;
+    nodes[z].links[1] = 0;
+
+    if (depth == 0)
+        root = z;
+    else if (key <= nodes[path[depth - 1]].key)
+        setLeft(path[depth - 1], z);
+    else
+        nodes[path[depth - 1]].links[1] = z;
+
+    pinsertFixup(z, path, depth);
+    nodeCount++;
+}
+
+/**
+ * Returns the node stored at index. The reference is invalidated by the next insertion or deletion.
+ *
+ * @param uint32_t
+ * @return const rbCompactNode<T>&
+ */
+template <class T>
+const rbCompactNode<T>& CompactRBT<T>::getNode(std::uint32_t index)
+{
+    return nodes[index];
+}
+
+/**
+ * Returns the index of the left child.
+ *
+ * @return uint32_t
+ */
+template <typename T>
+std::uint32_t rbCompactNode<T>::left() const
+{
+    return links[0] & ~COMPACT_COLOR_BIT;
+}
+
+/**
+ * Returns the index of the right child.
+ *
+ * @return uint32_t
+ */
+template <typename T>
+std::uint32_t rbCompactNode<T>::right() const
+{
+    return links[1];
+}
+
+/**
+ * Returns the color of the node as one of the rbColor values.
+ *
+ * @return char
+ */
+template <typename T>
+char rbCompactNode<T>::rbColor() const
+{
+    return (links[0] & COMPACT_COLOR_BIT) ? BLACK : RED;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              PRIVATE INTERFACE                                          ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the index of an unused slot, taken from the free list when possible and appended to the array otherwise.
+ *
+ * @return uint32_t
+ */
+template <class T>
+std::uint32_t CompactRBT<T>::allocate()
+{
+    if (freeList != 0)
+    {
+        std::uint32_t n = freeList;
+        freeList = nodes[n].links[1];
+        return n;
+    }
+
+    if (nodes.size() > COMPACT_MAX_NODES)
+        throw std::length_error("CompactRBT: node indices exhausted");
+
+    nodes.push_back(rbCompactNode<T>());
+    return nodes.size() - 1;
+}
+
+/**
+ * Returns true if the node is red, the sentinel is always black.
+ *
+ * @param uint32_t
+ * @return bool
+ */
+template <class T>
+bool CompactRBT<T>::isRed(std::uint32_t n)
+{
+    return (nodes[n].links[0] & COMPACT_COLOR_BIT) == 0;
+}
+
+/**
+ * Pushes a slot onto the free list, which is threaded through the right indices of the free slots.
+ *
+ * @param uint32_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::deallocate(std::uint32_t n)
+{
+    nodes[n].links[1] = freeList;
+    freeList = n;
+}
+
+/**
+ * Returns the index of the left child of n.
+ *
+ * @param uint32_t
+ * @return uint32_t
+ */
+template <class T>
+std::uint32_t CompactRBT<T>::left(std::uint32_t n)
+{
+    return nodes[n].links[0] & ~COMPACT_COLOR_BIT;
+}
+
+/**
+ * Returns the index of a node holding key, 0 if the key is not present.
+ *
+ * @param unsigned long long
+ * @return uint32_t
+ */
+template <class T>
+std::uint32_t CompactRBT<T>::psearch(unsigned long long key)
+{
+    const rbCompactNode<T>* base = nodes.data();
+    std::uint32_t x = root;
+
+    // both links are read with a single load and the comparison picks one with a mask, which compilers turn into a
+    // conditional move, so there is no hard to predict branch per level and the chain to the next node stays short
+    while (x != 0 && base[x].key != key)
+    {
+        std::uint64_t both;
+        std::memcpy(&both, base[x].links, sizeof(both));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        std::uint32_t l = std::uint32_t(both >> 32) & ~COMPACT_COLOR_BIT;
+        std::uint32_t r = std::uint32_t(both);
+#else
+        std::uint32_t l = std::uint32_t(both) & ~COMPACT_COLOR_BIT;
+        std::uint32_t r = std::uint32_t(both >> 32);
+#endif
+
+        x = r ^ ((l ^ r) & -std::uint32_t(key < base[x].key));
+    }
+
+    return x;
+}
+
+/**
+ * Sets the color of n, leaving its left index alone.
+ *
+ * @param uint32_t
+ * @param char
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::setColor(std::uint32_t n, char color)
+{
+    if (color == BLACK)
+        nodes[n].links[0] |= COMPACT_COLOR_BIT;
+    else
+        nodes[n].links[0] &= ~COMPACT_COLOR_BIT;
+}
+
+/**
+ * Sets the left child of n, leaving its color alone.
+ *
+ * @param uint32_t
+ * @param uint32_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::setLeft(std::uint32_t n, std::uint32_t child)
+{
+    nodes[n].links[0] = (nodes[n].links[0] & COMPACT_COLOR_BIT) | child;
+}
+
+/**
+ * Rotates x down to the left of its right child, parent is the parent of x or 0 when x is the root.
+ *
+ * @param uint32_t
+ * @param uint32_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::leftRotate(std::uint32_t x, std::uint32_t parent)
+{
+    std::uint32_t y = nodes[x].links[1];
+
+    nodes[x].links[1] = left(y);
+    setLeft(y, x);
+    replaceChild(parent, x, y);
+}
+
+/**
+ * Rotates y down to the right of its left child, parent is the parent of y or 0 when y is the root.
+ *
+ * @param uint32_t
+ * @param uint32_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::rightRotate(std::uint32_t y, std::uint32_t parent)
+{
+    std::uint32_t x = left(y);
+
+    setLeft(y, nodes[x].links[1]);
+    nodes[x].links[1] = y;
+    replaceChild(parent, y, x);
+}
+
+/**
+ * Restores the red black properties after a black node was removed above x. path holds the depth ancestors of x,
+ * its parent last; rotations which move a node above the parent are mirrored on the path.
+ *
+ * @param uint32_t
+ * @param uint32_t*
+ * @param int
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::pdelFixup(std::uint32_t x, std::uint32_t* path, int depth)
+{
+    while (depth > 0 && !isRed(x))
+    {
+        std::uint32_t p = path[depth - 1];
+        std::uint32_t grandparent = depth > 1 ? path[depth - 2] : 0;
+
+        // x may be the sentinel, but then its sibling is not, so comparing against the left child still tells the side
+        if (x == left(p))
+        {
+            std::uint32_t w = nodes[p].links[1];
+
+            if (isRed(w))
+            {
+                setColor(w, BLACK);
+                setColor(p, RED);
+                leftRotate(p, grandparent);
+                path[depth - 1] = w;
+                path[depth++] = p;
+                grandparent = w;
+                w = nodes[p].links[1];
+            }
+
+            if (!isRed(left(w)) && !isRed(nodes[w].links[1]))
+            {
+                setColor(w, RED);
+                x = p;
+                depth--;
+            }
+            else
+            {
+                if (!isRed(nodes[w].links[1]))
+                {
+                    setColor(left(w), BLACK);
+                    setColor(w, RED);
+                    rightRotate(w, p);
+                    w = nodes[p].links[1];
+                }
+
+                setColor(w, isRed(p) ? RED : BLACK);
+                setColor(p, BLACK);
+                setColor(nodes[w].links[1], BLACK);
+                leftRotate(p, grandparent);
+                x = root;
+                depth = 0;
+            }
+        }
+        else
+        {
+            std::uint32_t w = left(p);
+
+            if (isRed(w))
+            {
+                setColor(w, BLACK);
+                setColor(p, RED);
+                rightRotate(p, grandparent);
+                path[depth - 1] = w;
+                path[depth++] = p;
+                grandparent = w;
+                w = left(p);
+            }
+
+            if (!isRed(nodes[w].links[1]) && !isRed(left(w)))
+            {
+                setColor(w, RED);
+                x = p;
+                depth--;
+            }
+            else
+            {
+                if (!isRed(left(w)))
+                {
+                    setColor(nodes[w].links[1], BLACK);
+                    setColor(w, RED);
+                    leftRotate(w, p);
+                    w = left(p);
+                }
+
+                setColor(w, isRed(p) ? RED : BLACK);
+                setColor(p, BLACK);
+                setColor(left(w), BLACK);
+                rightRotate(p, grandparent);
+                x = root;
+                depth = 0;
+            }
+        }
+    }
+
+    if (x != 0)
+        setColor(x, BLACK);
+}
+
+/**
+ * Restores the red black properties after the red node z was linked in below the depth nodes on path.
+ *
+ * @param uint32_t
+ * @param uint32_t*
+ * @param int
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::pinsertFixup(std::uint32_t z, std::uint32_t* path, int depth)
+{
+    // a red parent is never the root, so the grandparent is always on the path
+    while (depth > 0 && isRed(path[depth - 1]))
+    {
+        std::uint32_t p = path[depth - 1];
+        std::uint32_t g = path[depth - 2];
+        std::uint32_t greatGrandparent = depth > 2 ? path[depth - 3] : 0;
+
+        if (p == left(g))
+        {
+            std::uint32_t uncle = nodes[g].links[1];
+
+            if (isRed(uncle))
+            {
+                setColor(p, BLACK);
+                setColor(uncle, BLACK);
+                setColor(g, RED);
+                z = g;
+                depth -= 2;
+                continue;
+            }
+
+            if (z == nodes[p].links[1])
+            {
+                leftRotate(p, g);
+                p = z;
+            }
+
+            setColor(p, BLACK);
+            setColor(g, RED);
+            rightRotate(g, greatGrandparent);
+        }
+        else
+        {
+            std::uint32_t uncle = left(g);
+
+            if (isRed(uncle))
+            {
+                setColor(p, BLACK);
+                setColor(uncle, BLACK);
+                setColor(g, RED);
+                z = g;
+                depth -= 2;
+                continue;
+            }
+
+            if (z == left(p))
+            {
+                rightRotate(p, g);
+                p = z;
+            }
+
+            setColor(p, BLACK);
+            setColor(g, RED);
+            leftRotate(g, greatGrandparent);
+        }
+        break;
+    }
+
+    setColor(root, BLACK);
+}
+
+/**
+ * Makes replacement take the place of child below parent, or the place of the root when parent is 0.
+ *
+ * @param uint32_t
+ * @param uint32_t
+ * @param uint32_t
+ * @return void
+ */
+template <class T>
+void CompactRBT<T>::replaceChild(std::uint32_t parent, std::uint32_t child, std::uint32_t replacement)
+{
+    if (parent == 0)
+        root = replacement;
+    else if (left(parent) == child)
+        setLeft(parent, replacement);
+    else
+        nodes[parent].links[1] = replacement;
+}
@@ -0,0 +1,130 @@
+#ifndef FROZENRBT_H
+#define  FROZENRBT_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <iterator>
+#include <functional>
+#include "rbt.h"
+
+// size of one block of the frozen layout, one cache line on the machines this is tuned for
+#define FROZEN_BLOCK_BYTES 64
+
+/**
+ * A frozen, read only tree header file containing all appropriate declarations.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * One node of the frozen layout, as many keys as fit in a cache line (but at least two), aligned to the line so a
+ * node never costs more than one miss.
+ */
+template <class Key>
+struct alignas(FROZEN_BLOCK_BYTES) rbFrozenBlock
+{
+    static const std::size_t B = sizeof(Key) * 2 > FROZEN_BLOCK_BYTES ? 2 : FROZEN_BLOCK_BYTES / sizeof(Key);
+
+    Key keys[B];
+};
+
+/**
+ * Counts the keys of a block which are less than key, or not greater than key if inclusive. Overloaded below with
+ * vectorized versions for the default key type.
+ */
+template <class Key, class Compare, std::size_t N>
+std::size_t rbFrozenRank(const Key (&keys)[N], const Key& key, bool inclusive, const Compare& comp);
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+inline std::size_t rbFrozenRank(const unsigned long long (&keys)[8], const unsigned long long& key, bool inclusive,
+    const std::less<unsigned long long>& comp);
+#endif
+
+/**
+ * Bidirectional iterator over a frozen tree in key order. Elements are addressed by their position in the sorted
+ * order, so stepping is an increment and key() and data() are array lookups.
+ */
+template <class Tree>
+class rbFrozenIterator
+{
+    public:
+        typedef typename Tree::key_type key_type;
+        typedef typename Tree::mapped_type mapped_type;
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef std::pair<const key_type&, const mapped_type&> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef void pointer;
+        typedef value_type reference;
+
+        rbFrozenIterator();
+        rbFrozenIterator(const Tree* tree, std::size_t index);
+        std::size_t position() const;
+        const key_type& key() const;
+        const mapped_type& data() const;
+        value_type operator*() const;
+        rbFrozenIterator& operator++();
+        rbFrozenIterator& operator--();
+        rbFrozenIterator operator++(int);
+        rbFrozenIterator operator--(int);
+        bool operator==(const rbFrozenIterator& other) const;
+        bool operator!=(const rbFrozenIterator& other) const;
+
+    private:
+        const Tree* tree;
+        std::size_t index;
+};
+
+/**
+ * Read only snapshot of a tree laid out for searching, produced by RBTree::freeze(). The sorted keys are stored in
+ * cache line sized blocks which form the leaves of an implicit B+ tree; each inner block holds, for its first B
+ * children, the largest key below that child, and has one more child than keys. Blocks of a level are stored next
+ * to each other and the position of a child follows from the position of its parent, so there are no pointers and
+ * a lookup touches one line per level, about a third of the levels of the red black tree. Values are kept in a
+ * separate array in key order and only read once the position of a key is known. Within a block the keys are
+ * compared all at once, with AVX2 or SSE4.2 for unsigned long long keys under std::less when the compiler targets
+ * them and with a branch free loop otherwise.
+ */
+template <class Key, class Value, class Compare = std::less<Key>>
+class FrozenRBT
+{
+    public:
+        typedef Key key_type;
+        typedef Value mapped_type;
+        typedef rbFrozenBlock<Key> block;
+        typedef rbFrozenIterator<FrozenRBT> iterator;
+
+        FrozenRBT(const Compare& comp = Compare());
+        FrozenRBT(std::vector<Key> keys, std::vector<Value> values, const Compare& comp = Compare());
+        iterator end() const;
+        iterator begin() const;
+        bool isEmpty() const;
+        std::size_t size() const;
+        std::size_t memoryUsage() const;
+        iterator find(const Key& key) const;
+        bool contains(const Key& key) const;
+        const Value* search(const Key& key) const;
+        const Key& keyAt(std::size_t index) const;
+        const Value& valueAt(std::size_t index) const;
+        iterator lower_bound(const Key& key) const;
+        iterator upper_bound(const Key& key) const;
+        template <class F>
+        void forEachInRange(const Key& lo, const Key& hi, F fn) const;
+
+    private:
+        static const std::size_t B = block::B;
+
+        std::size_t count;
+        Compare comp;
+        std::vector<block> blocks;
+        std::vector<std::size_t> levels;
+        std::vector<Value> values;
+
+        std::size_t pbound(const Key& key, bool inclusive) const;
+};
+
+// Include templated implementation file as it is necessary to present during compile time
+#include "frozenrbt.tpp"
+
+#endif
@@ -0,0 +1,530 @@
+#include "frozenrbt.h"
+#include <utility>
+#include <algorithm>
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * A frozen, read only tree template implementation file. The layout is the static B+ tree of the search literature
+ * (sometimes called an S+ tree), built bottom-up from the sorted elements of a red black tree.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                             PUBLIC INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates an empty frozen tree.
+ *
+ * @param const Compare&
+ * @return this
+ */
+template <class Key, class Value, class Compare>
+FrozenRBT<Key, Value, Compare>::FrozenRBT(const Compare& comp) : count(0), comp(comp)
+{
+}
+
+/**
+ * Builds the frozen layout from keys sorted by comp and the values belonging to them, in the same order. The
+ * sorted keys are cut into leaf blocks, the last one padded with copies of the largest key, and every level above
+ * gets one block per B + 1 blocks of the level below until a single root block remains. Each inner key is the
+ * largest key under the corresponding child, child positions past the end of the level get the largest key of the
+ * tree. Building takes O(n) time.
+ *
+ * @param std::vector<Key>
+ * @param std::vector<Value>
+ * @param const Compare&
+ * @return this
+ */
+template <class Key, class Value, class Compare>
+FrozenRBT<Key, Value, Compare>::FrozenRBT(std::vector<Key> keys, std::vector<Value> values, const Compare& comp) :
+    count(keys.size()), comp(comp), values(std::move(values))
+{
+    if (count == 0)
+        return;
+
+    // number of blocks of every level from the leaves up, and the index of the largest key under each block
+    std::vector<std::size_t> sizes(1, (count + B - 1) / B);
+    std::vector<std::vector<std::size_t>> largest(1);
+
+    for (std::size_t c = 0; c < sizes[0]; c++)
+        largest[0].push_back(std::min(count, (c + 1) * B) - 1);
+
+    while (sizes.back() > 1)
+    {
+        const std::vector<std::size_t>& below = largest.back();
+        std::vector<std::size_t> above;
+
+        for (std::size_t j = 0; j * (B + 1) < below.size(); j++)
+            above.push_back(below[std::min(below.size(), (j + 1) * (B + 1)) - 1]);
+
+        sizes.push_back(above.size());
+        largest.push_back(std::move(above));
+    }
+
+    // the root level is stored first and the leaves last
+    std::size_t total = 0;
+    levels.resize(sizes.size());
+
+    for (std::size_t h = sizes.size(); h-- > 0;)
+    {
+        levels[sizes.size() - 1 - h] = total;
+        total += sizes[h];
+    }
+
+    blocks.resize(total);
+
+    block* leaves = blocks.data() + levels.back();
+    for (std::size_t i = 0; i < sizes[0] * B; i++)
+        leaves[i / B].keys[i % B] = keys[i < count ? i : count - 1];
+
+    for (std::size_t h = 1; h < sizes.size(); h++)
+    {
+        block* level = blocks.data() + levels[sizes.size() - 1 - h];
+        const std::vector<std::size_t>& below = largest[h - 1];
+
+        for (std::size_t j = 0; j < sizes[h]; j++)
+        {
+            for (std::size_t i = 0; i < B; i++)
+            {
+                std::size_t child = j * (B + 1) + i;
+                level[j].keys[i] = keys[child < below.size() ? below[child] : count - 1];
+            }
+        }
+    }
+}
+
+/**
+ * Returns the past-the-end iterator.
+ *
+ * @return iterator
+ */
+template <class Key, class Value, class Compare>
+typename FrozenRBT<Key, Value, Compare>::iterator FrozenRBT<Key, Value, Compare>::end() const
+{
+    return iterator(this, count);
+}
+
+/**
+ * Returns an iterator to the element with the smallest key.
+ *
+ * @return iterator
+ */
+template <class Key, class Value, class Compare>
+typename FrozenRBT<Key, Value, Compare>::iterator FrozenRBT<Key, Value, Compare>::begin() const
+{
+    return iterator(this, 0);
+}
+
+/**
+ * Returns true if the tree holds no elements.
+ *
+ * @return bool
+ */
+template <class Key, class Value, class Compare>
+bool FrozenRBT<Key, Value, Compare>::isEmpty() const
+{
+    return count == 0;
+}
+
+/**
+ * Returns the number of elements in the tree.
+ *
+ * @return size_t
+ */
+template <class Key, class Value, class Compare>
+std::size_t FrozenRBT<Key, Value, Compare>::size() const
+{
+    return count;
+}
+
+/**
+ * Returns the number of bytes held by the key blocks, the value array and the level table.
+ *
+ * @return size_t
+ */
+template <class Key, class Value, class Compare>
+std::size_t FrozenRBT<Key, Value, Compare>::memoryUsage() const
+{
+    return blocks.capacity() * sizeof(block) + values.capacity() * sizeof(Value) +
+        levels.capacity() * sizeof(std::size_t);
+}
+
+/**
+ * Returns an iterator to the first element whose key is equal to key, or end() if there is none.
+ *
+ * @param const Key&
+ * @return iterator
+ */
+template <class Key, class Value, class Compare>
+typename FrozenRBT<Key, Value, Compare>::iterator FrozenRBT<Key, Value, Compare>::find(const Key& key) const
+{
+    std::size_t i = pbound(key, false);
+
+    if (i == count || comp(key, keyAt(i)))
+        return end();
+
+    return iterator(this, i);
+}
+
+/**
+ * Returns true if an element with the given key is present.
+ *
+ * @param const Key&
+ * @return bool
+ */
+template <class Key, class Value, class Compare>
+bool FrozenRBT<Key, Value, Compare>::contains(const Key& key) const
+{
+    std::size_t i = pbound(key, false);
+
+    return i != count && !comp(key, keyAt(i));
+}
+
+/**
+ * Returns the value of the first element whose key is equal to key, or nullptr if there is none.
+ *
+ * @param const Key&
+ * @return const Value*
+ */
+template <class Key, class Value, class Compare>
+const Value* FrozenRBT<Key, Value, Compare>::search(const Key& key) const
+{
+    std::size_t i = pbound(key, false);
+
+    if (i == count || comp(key, keyAt(i)))
+        return nullptr;
+
+    return &values[i];
+}
+
+/**
+ * Returns the key at the given position of the sorted order.
+ *
+ * @param size_t
+ * @return const Key&
+ */
+template <class Key, class Value, class Compare>
+const Key& FrozenRBT<Key, Value, Compare>::keyAt(std::size_t index) const
+{
+    return blocks[levels.back() + index / B].keys[index % B];
+}
+
+/**
+ * Returns the value at the given position of the sorted order.
+ *
+ * @param size_t
+ * @return const Value&
+ */
+template <class Key, class Value, class Compare>
+const Value& FrozenRBT<Key, Value, Compare>::valueAt(std::size_t index) const
+{
+    return values[index];
+}
+
+/**
+ * Returns an iterator to the first element whose key is not less than key, or end() if there is none.
+ *
+ * @param const Key&
+ * @return iterator
+ */
+template <class Key, class Value, class Compare>
+typename FrozenRBT<Key, Value, Compare>::iterator FrozenRBT<Key, Value, Compare>::lower_bound(const Key& key) const
+{
+    return iterator(this, pbound(key, false));
+}
+
+/**
+ * Returns an iterator to the first element whose key is greater than key, or end() if there is none.
+ *
+ * @param const Key&
+ * @return iterator
+ */
+template <class Key, class Value, class Compare>
+typename FrozenRBT<Key, Value, Compare>::iterator FrozenRBT<Key, Value, Compare>::upper_bound(const Key& key) const
+{
+    return iterator(this, pbound(key, true));
+}
+
+/**
+ * Calls fn with the key and value of every element whose key lies in [lo, hi), in key order. After the initial
+ * lookup the elements are read sequentially from the leaf blocks and the value array.
+ *
+ * @param const Key&
+ * @param const Key&
+ * @param F
+ * @return void
+ */
+template <class Key, class Value, class Compare>
+template <class F>
+void FrozenRBT<Key, Value, Compare>::forEachInRange(const Key& lo, const Key& hi, F fn) const
+{
+    for (std::size_t i = pbound(lo, false); i < count && comp(keyAt(i), hi); i++)
+        fn(keyAt(i), values[i]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                            PRIVATE INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the position of the first key that is not less than key, or greater than key if inclusive, or count if
+ * there is none. Keys beyond the largest one are answered without descending, which also guarantees that the
+ * padding is never counted. On each level the number of keys of the block that lie before key selects the child,
+ * the final count within the leaf block gives the position. Once the leaf block is known the line of the value
+ * array belonging to it is prefetched, so that a following search() does not wait for a second miss.
+ *
+ * @param const Key&
+ * @param bool
+ * @return size_t
+ */
+template <class Key, class Value, class Compare>
+std::size_t FrozenRBT<Key, Value, Compare>::pbound(const Key& key, bool inclusive) const
+{
+    if (count == 0)
+        return 0;
+
+    const Key& largest = keyAt(count - 1);
+    if (inclusive ? !comp(key, largest) : comp(largest, key))
+        return count;
+
+    const block* base = blocks.data();
+    std::size_t k = 0;
+
+    for (std::size_t h = 0; h + 1 < levels.size(); h++)
+        k = k * (B + 1) + rbFrozenRank(base[levels[h] + k].keys, key, inclusive, comp);
+
+    __builtin_prefetch(values.data() + k * B);
+
+    return k * B + rbFrozenRank(base[levels.back() + k].keys, key, inclusive, comp);
+}
+
+/**
+ * Portable block comparison. Every key is compared and the results are summed, so the loop has no data dependent
+ * branch and the compiler is free to vectorize it.
+ *
+ * @param const Key(&)[N]
+ * @param const Key&
+ * @param bool
+ * @param const Compare&
+ * @return size_t
+ */
+template <class Key, class Compare, std::size_t N>
+std::size_t rbFrozenRank(const Key (&keys)[N], const Key& key, bool inclusive, const Compare& comp)
+{
+    std::size_t r = 0;
+
+    if (inclusive)
+    {
+        for (std::size_t i = 0; i < N; i++)
+            r += !comp(key, keys[i]);
+    }
+    else
+    {
+        for (std::size_t i = 0; i < N; i++)
+            r += comp(keys[i], key);
+    }
+
+    return r;
+}
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+/**
+ * Vectorized block comparison for the eight unsigned long long keys of a block. The instruction sets only provide
+ * a signed 64 bit greater-than, so both sides have their sign bit flipped first, which maps the unsigned order onto
+ * the signed one. The comparison masks are collapsed into one bit per key and counted.
+ *
+ * @param const unsigned long long(&)[8]
+ * @param const unsigned long long&
+ * @param bool
+ * @param const std::less<unsigned long long>&
+ * @return size_t
+ */
+inline std::size_t rbFrozenRank(const unsigned long long (&keys)[8], const unsigned long long& key, bool inclusive,
+    const std::less<unsigned long long>&)
+{
+    unsigned mask;
+
+#if defined(__AVX2__)
+    const __m256i flip = _mm256_set1_epi64x((long long) 0x8000000000000000ull);
+    const __m256i x = _mm256_xor_si256(_mm256_set1_epi64x((long long) key), flip);
+    const __m256i a = _mm256_xor_si256(_mm256_load_si256((const __m256i*) keys), flip);
+    const __m256i b = _mm256_xor_si256(_mm256_load_si256((const __m256i*) (keys + 4)), flip);
+
+    if (inclusive)
+    {
+        // keys greater than key, the rest are counted
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(a, x))) |
+            _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(b, x))) << 4;
+        return 8 - __builtin_popcount(mask);
+    }
+
+    mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, a))) |
+        _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(x, b))) << 4;
+#else
+    const __m128i flip = _mm_set1_epi64x((long long) 0x8000000000000000ull);
+    const __m128i x = _mm_xor_si128(_mm_set1_epi64x((long long) key), flip);
+    mask = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        const __m128i a = _mm_xor_si128(_mm_load_si128((const __m128i*) (keys + 2 * i)), flip);
+        const __m128i gt = inclusive ? _mm_cmpgt_epi64(a, x) : _mm_cmpgt_epi64(x, a);
+        mask |= _mm_movemask_pd(_mm_castsi128_pd(gt)) << (2 * i);
+    }
+
+    if (inclusive)
+        return 8 - __builtin_popcount(mask);
+#endif
+
+    return __builtin_popcount(mask);
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                                 ITERATOR                                                ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates a singular iterator which is not attached to any tree.
+ *
+ * @return this
+ */
+template <class Tree>
+rbFrozenIterator<Tree>::rbFrozenIterator() : tree(nullptr), index(0)
+{
+}
+
+/**
+ * Creates an iterator to the element at the given position of the sorted order of tree.
+ *
+ * @param const Tree*
+ * @param size_t
+ * @return this
+ */
+template <class Tree>
+rbFrozenIterator<Tree>::rbFrozenIterator(const Tree* tree, std::size_t index) : tree(tree), index(index)
+{
+}
+
+/**
+ * Returns the position of the element in the sorted order, size() for the end iterator.
+ *
+ * @return size_t
+ */
+template <class Tree>
+std::size_t rbFrozenIterator<Tree>::position() const
+{
+    return index;
+}
+
+/**
+ * Returns the key of the element.
+ *
+ * @return const key_type&
+ */
+template <class Tree>
+const typename rbFrozenIterator<Tree>::key_type& rbFrozenIterator<Tree>::key() const
+{
+    return tree->keyAt(index);
+}
+
+/**
+ * Returns the value of the element.
+ *
+ * @return const mapped_type&
+ */
+template <class Tree>
+const typename rbFrozenIterator<Tree>::mapped_type& rbFrozenIterator<Tree>::data() const
+{
+    return tree->valueAt(index);
+}
+
+/**
+ * Returns the key and value of the element as a pair of references.
+ *
+ * @return value_type
+ */
+template <class Tree>
+typename rbFrozenIterator<Tree>::value_type rbFrozenIterator<Tree>::operator*() const
+{
+    return value_type(key(), data());
+}
+
+/**
+ * Advances to the next element.
+ *
+ * @return rbFrozenIterator&
+ */
+template <class Tree>
+rbFrozenIterator<Tree>& rbFrozenIterator<Tree>::operator++()
+{
+    index++;
+    return *this;
+}
+
+/**
+ * Steps back to the previous element.
+ *
+ * @return rbFrozenIterator&
+ */
+template <class Tree>
+rbFrozenIterator<Tree>& rbFrozenIterator<Tree>::operator--()
+{
+    index--;
+    return *this;
+}
+
+/**
+ * Advances to the next element and returns the previous position.
+ *
+ * @return rbFrozenIterator
+ */
+template <class Tree>
+rbFrozenIterator<Tree> rbFrozenIterator<Tree>::operator++(int)
+{
+    rbFrozenIterator previous = *this;
+    index++;
+    return previous;
+}
+
+/**
+ * Steps back to the previous element and returns the previous position.
+ *
+ * @return rbFrozenIterator
+ */
+template <class Tree>
+rbFrozenIterator<Tree> rbFrozenIterator<Tree>::operator--(int)
+{
+    rbFrozenIterator previous = *this;
+    index--;
+    return previous;
+}
+
+/**
+ * Returns true if both iterators refer to the same position of the same tree.
+ *
+ * @param const rbFrozenIterator&
+ * @return bool
+ */
+template <class Tree>
+bool rbFrozenIterator<Tree>::operator==(const rbFrozenIterator& other) const
+{
+    return tree == other.tree && index == other.index;
+}
+
+/**
+ * Returns true if the iterators refer to different positions.
+ *
+ * @param const rbFrozenIterator&
+ * @return bool
+ */
+template <class Tree>
+bool rbFrozenIterator<Tree>::operator!=(const rbFrozenIterator& other) const
+{
+    return !(*this == other);
+}
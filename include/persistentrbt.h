@@ -0,0 +1,162 @@
+#ifndef PERSISTENTRBT_H
+#define  PERSISTENTRBT_H
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <iterator>
+#include "rbt.h"
+
+/**
+ * A persistent red black tree header file containing all appropriate declarations.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * Immutable, reference counted node of the persistent tree. There is no parent pointer and no shared sentinel,
+ * empty subtrees are null links, so a node can be part of any number of tree versions at the same time. Once a
+ * node has been built none of its fields change, only its reference count does.
+ */
+template <typename T>
+struct rbPersistentNode;
+
+/**
+ * Intrusive reference counted pointer to a persistent node. Copying a link takes a reference and destroying it
+ * drops one; the node, and with it the references it holds on its children, goes away with the last link.
+ */
+template <typename T>
+class rbLink
+{
+    public:
+        rbLink();
+        ~rbLink();
+        rbLink(rbPersistentNode<T>* node);
+        rbLink(const rbLink& other);
+        rbLink(rbLink&& other);
+        rbLink& operator=(rbLink other);
+        explicit operator bool() const;
+        rbPersistentNode<T>* get() const;
+        rbPersistentNode<T>* operator->() const;
+
+    private:
+        rbPersistentNode<T>* node;
+};
+
+template <typename T>
+struct rbPersistentNode
+{
+    const unsigned long long key;
+    T* const data;
+    const char rbColor;
+    const rbLink<T> left, right;
+    mutable std::atomic<unsigned> refs;
+
+    rbPersistentNode(char color, const rbLink<T>& left, unsigned long long key, T* data, const rbLink<T>& right);
+};
+
+/**
+ * Forward iterator over a persistent tree version in key order. Without parent pointers the path back up is kept
+ * on a small explicit stack which never grows beyond the height of the tree.
+ */
+template <class T>
+class rbPersistentIterator
+{
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef rbPersistentNode<T> value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const rbPersistentNode<T>* pointer;
+        typedef const rbPersistentNode<T>& reference;
+
+        rbPersistentIterator();
+        rbPersistentIterator(std::vector<const rbPersistentNode<T>*> path);
+        const rbPersistentNode<T>* get() const;
+        const rbPersistentNode<T>& operator*() const;
+        const rbPersistentNode<T>* operator->() const;
+        rbPersistentIterator& operator++();
+        rbPersistentIterator operator++(int);
+        bool operator==(const rbPersistentIterator& other) const;
+        bool operator!=(const rbPersistentIterator& other) const;
+
+    private:
+        std::vector<const rbPersistentNode<T>*> path;
+};
+
+/**
+ * Immutable handle on one version of a persistent tree. Copying a snapshot only takes a reference on its root so
+ * snapshots can be passed around freely, and since nothing reachable from the root ever changes a snapshot can be
+ * searched and iterated from any number of threads without locks while writers keep producing new versions.
+ */
+template <class T>
+class rbSnapshot
+{
+    public:
+        typedef rbPersistentIterator<T> iterator;
+
+        rbSnapshot();
+        rbSnapshot(const rbLink<T>& root, std::size_t count);
+        iterator end() const;
+        iterator begin() const;
+        bool isEmpty() const;
+        std::size_t size() const;
+        iterator find(unsigned long long key) const;
+        const rbPersistentNode<T>* getRoot() const;
+        const rbPersistentNode<T>* search(unsigned long long key) const;
+        iterator lower_bound(unsigned long long key) const;
+        template <class F>
+        void forEachInRange(unsigned long long lo, unsigned long long hi, F fn) const;
+
+    private:
+        rbLink<T> root;
+        std::size_t count;
+};
+
+/**
+ * Persistent red black tree. Updates never modify a node in place; they copy the O(log n) nodes on the path they
+ * change and share every other node with the previous version. Writers are serialized among themselves and
+ * publish each new root with a pointer swap, snapshot() takes a reference on the latest root under the same brief
+ * lock. Readers holding a snapshot never block writers and never see a partially applied update.
+ */
+template <class T>
+class PersistentRBT
+{
+    public:
+        PersistentRBT();
+        void clear();
+        bool isEmpty();
+        std::size_t size();
+        rbSnapshot<T> snapshot();
+        T* search(unsigned long long key);
+        bool del(unsigned long long key);
+        bool contains(unsigned long long key);
+        void insert(unsigned long long key, T* data);
+
+    private:
+        typedef rbLink<T> link;
+
+        std::mutex writeLock;
+        std::mutex publishLock;
+        link current;
+        std::size_t count;
+
+        void publish(link root, std::size_t size);
+        static bool isRed(const link& n);
+        static bool isBlack(const link& n);
+        static link app(const link& a, const link& b);
+        static link sub1(const link& n);
+        static link ins(const link& s, unsigned long long key, T* data);
+        static link del(const link& t, unsigned long long key);
+        static link balleft(const link& l, const link& y, const link& r);
+        static link balright(const link& l, const link& y, const link& r);
+        static link balance(const link& l, const link& y, const link& r);
+        static link make(char color, const link& l, const link& y, const link& r);
+        static link make(char color, const link& l, unsigned long long key, T* data, const link& r);
+};
+
+// Include templated implementation file as it is necessary to present during compile time
+#include "persistentrbt.tpp"
+
+#endif
@@ -0,0 +1,825 @@
+#include "persistentrbt.h"
+#include <utility>
+
+/**
+ * A persistent red black tree template implementation file which contains the path copying insertion and deletion
+ * logic, the reference counting of the shared nodes and the snapshot queries. Insertion follows Okasaki's balance
+ * scheme and deletion the one given by Kahrs, both rebuild only the nodes along the search path.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                             PUBLIC INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates an empty persistent tree.
+ *
+ * @return this
+ */
+template <class T>
+PersistentRBT<T>::PersistentRBT()
+{
+    count = 0;
+}
+
+/**
+ * Publishes an empty version. Snapshots taken earlier keep every node they can reach alive.
+ *
+ * @return void
+ */
+template <class T>
+void PersistentRBT<T>::clear()
+{
+    std::lock_guard<std::mutex> guard(writeLock);
+    publish(link(), 0);
+}
+
+/**
+ * Returns true if the latest version holds no elements.
+ *
+ * @return bool
+ */
+template <class T>
+bool PersistentRBT<T>::isEmpty()
+{
+    return size() == 0;
+}
+
+/**
+ * Returns the number of elements in the latest version.
+ *
+ * @return size_t
+ */
+template <class T>
+std::size_t PersistentRBT<T>::size()
+{
+    std::lock_guard<std::mutex> guard(publishLock);
+    return count;
+}
+
+/**
+ * Returns an immutable handle on the latest version. Only a reference on the root is taken, so this is O(1)
+ * regardless of the size of the tree and never waits for an update to finish, only for a root pointer swap.
+ *
+ * @return rbSnapshot<T>
+ */
+template <class T>
+rbSnapshot<T> PersistentRBT<T>::snapshot()
+{
+    std::lock_guard<std::mutex> guard(publishLock);
+    return rbSnapshot<T>(current, count);
+}
+
+/**
+ * Looks up key in the latest version and returns the data stored with it, or nullptr if the key is not present.
+ *
+ * @param unsigned long long
+ * @return T*
+ */
+template <class T>
+T* PersistentRBT<T>::search(unsigned long long key)
+{
+    rbSnapshot<T> version = snapshot();
+    const rbPersistentNode<T>* n = version.search(key);
+
+    if (n == nullptr)
+        return nullptr;
+    return n->data;
+}
+
+/**
+ * Publishes a version with one element holding key removed, returns false and leaves the tree untouched if the
+ * key is not present. Only the nodes on the path to the removed element are copied.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T>
+bool PersistentRBT<T>::del(unsigned long long key)
+{
+    std::lock_guard<std::mutex> guard(writeLock);
+
+    // the rebalancing below relies on the key being found, absent keys would break the black height bookkeeping
+    if (rbSnapshot<T>(current, count).search(key) == nullptr)
+        return false;
+
+    link root = del(current, key);
+
+    if (isRed(root))
+        root = make(BLACK, root->left, root, root->right);
+
+    publish(root, count - 1);
+    return true;
+}
+
+/**
+ * Returns true if key is present in the latest version.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T>
+bool PersistentRBT<T>::contains(unsigned long long key)
+{
+    return snapshot().search(key) != nullptr;
+}
+
+/**
+ * Publishes a version which additionally holds key and data. Equal keys are kept, like in RBT, and go to the left.
+ * Only the nodes on the insertion path are copied.
+ *
+ * @param unsigned long long
+ * @param T*
+ * @return void
+ */
+template <class T>
+void PersistentRBT<T>::insert(unsigned long long key, T* data)
+{
+    std::lock_guard<std::mutex> guard(writeLock);
+
+    link root = ins(current, key, data);
+
+    if (isRed(root))
+        root = make(BLACK, root->left, root, root->right);
+
+    publish(root, count + 1);
+}
+
+/**
+ * Creates a snapshot of the empty tree.
+ *
+ * @return this
+ */
+template <class T>
+rbSnapshot<T>::rbSnapshot()
+{
+    count = 0;
+}
+
+/**
+ * Creates a snapshot of the version rooted at root, which holds count elements.
+ *
+ * @param rbLink<T>&
+ * @param size_t
+ * @return this
+ */
+template <class T>
+rbSnapshot<T>::rbSnapshot(const rbLink<T>& root, std::size_t count) : root(root)
+{
+    this->count = count;
+}
+
+/**
+ * Returns the past the end iterator.
+ *
+ * @return iterator
+ */
+template <class T>
+typename rbSnapshot<T>::iterator rbSnapshot<T>::end() const
+{
+    return iterator();
+}
+
+/**
+ * Returns an iterator to the smallest element.
+ *
+ * @return iterator
+ */
+template <class T>
+typename rbSnapshot<T>::iterator rbSnapshot<T>::begin() const
+{
+    std::vector<const rbPersistentNode<T>*> path;
+
+    for (const rbPersistentNode<T>* n = root.get(); n != nullptr; n = n->left.get())
+        path.push_back(n);
+
+    return iterator(path);
+}
+
+/**
+ * Returns true if the snapshot holds no elements.
+ *
+ * @return bool
+ */
+template <class T>
+bool rbSnapshot<T>::isEmpty() const
+{
+    return count == 0;
+}
+
+/**
+ * Returns the number of elements in the snapshot.
+ *
+ * @return size_t
+ */
+template <class T>
+std::size_t rbSnapshot<T>::size() const
+{
+    return count;
+}
+
+/**
+ * Returns an iterator to the first element holding key, or end() if the key is not present.
+ *
+ * @param unsigned long long
+ * @return iterator
+ */
+template <class T>
+typename rbSnapshot<T>::iterator rbSnapshot<T>::find(unsigned long long key) const
+{
+    iterator it = lower_bound(key);
+
+    if (it == end() || it->key != key)
+        return end();
+    return it;
+}
+
+/**
+ * Returns the root node of the snapshot, nullptr when it is empty.
+ *
+ * @return const rbPersistentNode<T>*
+ */
+template <class T>
+const rbPersistentNode<T>* rbSnapshot<T>::getRoot() const
+{
+    return root.get();
+}
+
+/**
+ * Returns a node holding key, or nullptr if the key is not present. The node stays valid as long as this snapshot,
+ * or any other handle sharing it, is alive.
+ *
+ * @param unsigned long long
+ * @return const rbPersistentNode<T>*
+ */
+template <class T>
+const rbPersistentNode<T>* rbSnapshot<T>::search(unsigned long long key) const
+{
+    const rbPersistentNode<T>* n = root.get();
+
+    while (n != nullptr && n->key != key)
+        n = key < n->key ? n->left.get() : n->right.get();
+
+    return n;
+}
+
+/**
+ * Returns an iterator to the first element whose key is not less than key. Every node at which the search turns
+ * left is kept on the iterator's path, which is exactly the set of ancestors still to be visited in order.
+ *
+ * @param unsigned long long
+ * @return iterator
+ */
+template <class T>
+typename rbSnapshot<T>::iterator rbSnapshot<T>::lower_bound(unsigned long long key) const
+{
+    std::vector<const rbPersistentNode<T>*> path;
+    const rbPersistentNode<T>* n = root.get();
+
+    while (n != nullptr)
+    {
+        if (n->key >= key)
+        {
+            path.push_back(n);
+            n = n->left.get();
+        }
+        else
+            n = n->right.get();
+    }
+
+    return iterator(path);
+}
+
+/**
+ * Calls fn with every node whose key lies in [lo, hi), in key order.
+ *
+ * @param unsigned long long
+ * @param unsigned long long
+ * @param F
+ * @return void
+ */
+template <class T>
+template <class F>
+void rbSnapshot<T>::forEachInRange(unsigned long long lo, unsigned long long hi, F fn) const
+{
+    for (iterator it = lower_bound(lo); it != end() && it->key < hi; ++it)
+        fn(it.get());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                                 NODES                                                   ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Builds a node which takes a reference on both of its children. The node itself starts without references, the
+ * first link pointing at it takes one.
+ *
+ * @param char
+ * @param rbLink<T>&
+ * @param unsigned long long
+ * @param T*
+ * @param rbLink<T>&
+ * @return this
+ */
+template <typename T>
+rbPersistentNode<T>::rbPersistentNode(char color, const rbLink<T>& left, unsigned long long key, T* data,
+                                      const rbLink<T>& right)
+    : key(key), data(data), rbColor(color), left(left), right(right), refs(0)
+{
+}
+
+/**
+ * Creates an empty link.
+ *
+ * @return this
+ */
+template <typename T>
+rbLink<T>::rbLink()
+{
+    node = nullptr;
+}
+
+/**
+ * Drops the reference held on the node, freeing it when this was the last one. Freeing a node drops its own
+ * references on its children in turn, so an unreachable version is reclaimed down to the nodes it shares.
+ *
+ * @return void
+ */
+template <typename T>
+rbLink<T>::~rbLink()
+{
+    if (node != nullptr && node->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        delete node;
+}
+
+/**
+ * Creates a link taking a reference on node.
+ *
+ * @param rbPersistentNode<T>*
+ * @return this
+ */
+template <typename T>
+rbLink<T>::rbLink(rbPersistentNode<T>* node)
+{
+    this->node = node;
+
+    if (node != nullptr)
+        node->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Creates a second link to the node of other.
+ *
+ * @param rbLink&
+ * @return this
+ */
+template <typename T>
+rbLink<T>::rbLink(const rbLink& other) : rbLink(other.node)
+{
+}
+
+/**
+ * Takes over the reference held by other without touching the count.
+ *
+ * @param rbLink&&
+ * @return this
+ */
+template <typename T>
+rbLink<T>::rbLink(rbLink&& other)
+{
+    node = other.node;
+    other.node = nullptr;
+}
+
+/**
+ * Points this link at the node of other, releasing the node it pointed at before.
+ *
+ * @param rbLink
+ * @return rbLink&
+ */
+template <typename T>
+rbLink<T>& rbLink<T>::operator=(rbLink other)
+{
+    std::swap(node, other.node);
+    return *this;
+}
+
+/**
+ * Returns true if the link points at a node.
+ *
+ * @return bool
+ */
+template <typename T>
+rbLink<T>::operator bool() const
+{
+    return node != nullptr;
+}
+
+/**
+ * Returns the node, nullptr for an empty link.
+ *
+ * @return rbPersistentNode<T>*
+ */
+template <typename T>
+rbPersistentNode<T>* rbLink<T>::get() const
+{
+    return node;
+}
+
+/**
+ * Gives access to the members of the node.
+ *
+ * @return rbPersistentNode<T>*
+ */
+template <typename T>
+rbPersistentNode<T>* rbLink<T>::operator->() const
+{
+    return node;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                                ITERATOR                                                 ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates the past the end iterator.
+ *
+ * @return this
+ */
+template <class T>
+rbPersistentIterator<T>::rbPersistentIterator()
+{
+}
+
+/**
+ * Creates an iterator from the ancestors still to be visited, the current node on top.
+ *
+ * @param vector<const rbPersistentNode<T>*>
+ * @return this
+ */
+template <class T>
+rbPersistentIterator<T>::rbPersistentIterator(std::vector<const rbPersistentNode<T>*> path) : path(std::move(path))
+{
+}
+
+/**
+ * Returns the current node, nullptr for the past the end iterator.
+ *
+ * @return const rbPersistentNode<T>*
+ */
+template <class T>
+const rbPersistentNode<T>* rbPersistentIterator<T>::get() const
+{
+    return path.empty() ? nullptr : path.back();
+}
+
+/**
+ * Returns the current node.
+ *
+ * @return const rbPersistentNode<T>&
+ */
+template <class T>
+const rbPersistentNode<T>& rbPersistentIterator<T>::operator*() const
+{
+    return *path.back();
+}
+
+/**
+ * Gives access to the members of the current node.
+ *
+ * @return const rbPersistentNode<T>*
+ */
+template <class T>
+const rbPersistentNode<T>* rbPersistentIterator<T>::operator->() const
+{
+    return path.back();
+}
+
+/**
+ * Moves to the in-order successor: the leftmost node of the right subtree if there is one, otherwise the closest
+ * ancestor still on the path.
+ *
+ * @return rbPersistentIterator&
+ */
+template <class T>
+rbPersistentIterator<T>& rbPersistentIterator<T>::operator++()
+{
+    const rbPersistentNode<T>* n = path.back()->right.get();
+    path.pop_back();
+
+    for (; n != nullptr; n = n->left.get())
+        path.push_back(n);
+
+    return *this;
+}
+
+/**
+ * Moves to the in-order successor and returns the previous position.
+ *
+ * @return rbPersistentIterator
+ */
+template <class T>
+rbPersistentIterator<T> rbPersistentIterator<T>::operator++(int)
+{
+    rbPersistentIterator<T> previous = *this;
+    ++(*this);
+    return previous;
+}
+
+/**
+ * Two iterators are equal if they point at the same node.
+ *
+ * @param rbPersistentIterator&
+ * @return bool
+ */
+template <class T>
+bool rbPersistentIterator<T>::operator==(const rbPersistentIterator& other) const
+{
+    return get() == other.get();
+}
+
+/**
+ * Two iterators are unequal if they point at different nodes.
+ *
+ * @param rbPersistentIterator&
+ * @return bool
+ */
+template <class T>
+bool rbPersistentIterator<T>::operator!=(const rbPersistentIterator& other) const
+{
+    return get() != other.get();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              PRIVATE INTERFACE                                          ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Makes root the latest version. The previous root is released only after the lock is dropped, so tearing down a
+ * version nobody else holds never delays snapshot().
+ *
+ * @param link
+ * @param size_t
+ * @return void
+ */
+template <class T>
+void PersistentRBT<T>::publish(link root, std::size_t size)
+{
+    {
+        std::lock_guard<std::mutex> guard(publishLock);
+        std::swap(current, root);
+        count = size;
+    }
+}
+
+/**
+ * Returns true for a red node, empty subtrees are black.
+ *
+ * @param link&
+ * @return bool
+ */
+template <class T>
+bool PersistentRBT<T>::isRed(const link& n)
+{
+    return n && n->rbColor == RED;
+}
+
+/**
+ * Returns true for an actual black node, empty subtrees do not count.
+ *
+ * @param link&
+ * @return bool
+ */
+template <class T>
+bool PersistentRBT<T>::isBlack(const link& n)
+{
+    return n && n->rbColor == BLACK;
+}
+
+/**
+ * Joins the two subtrees left behind by a removed node, a and b have the same black height and every key of a is
+ * not greater than any key of b. The result may have a red root with a red child, which the caller resolves.
+ *
+ * @param link&
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::app(const link& a, const link& b)
+{
+    if (!a)
+        return b;
+    if (!b)
+        return a;
+
+    if (isRed(a) && isRed(b))
+    {
+        link bc = app(a->right, b->left);
+
+        if (isRed(bc))
+            return make(RED, make(RED, a->left, a, bc->left), bc, make(RED, bc->right, b, b->right));
+        return make(RED, a->left, a, make(RED, bc, b, b->right));
+    }
+
+    if (isBlack(a) && isBlack(b))
+    {
+        link bc = app(a->right, b->left);
+
+        if (isRed(bc))
+            return make(RED, make(BLACK, a->left, a, bc->left), bc, make(BLACK, bc->right, b, b->right));
+        return balleft(a->left, a, make(BLACK, bc, b, b->right));
+    }
+
+    if (isRed(b))
+        return make(RED, app(a, b->left), b, b->right);
+    return make(RED, a->left, a, app(a->right, b));
+}
+
+/**
+ * Returns a red copy of the black node n, lowering its black height by one.
+ *
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::sub1(const link& n)
+{
+    return make(RED, n->left, n, n->right);
+}
+
+/**
+ * Returns a copy of s with key and data added, rebalancing on the way back up. A red root with a red child is
+ * left for the caller to blacken.
+ *
+ * @param link&
+ * @param unsigned long long
+ * @param T*
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::ins(const link& s, unsigned long long key, T* data)
+{
+    if (!s)
+        return make(RED, link(), key, data, link());
+
+    if (isBlack(s))
+    {
+        if (key <= s->key)
+            return balance(ins(s->left, key, data), s, s->right);
+        return balance(s->left, s, ins(s->right, key, data));
+    }
+
+    if (key <= s->key)
+        return make(RED, ins(s->left, key, data), s, s->right);
+    return make(RED, s->left, s, ins(s->right, key, data));
+}
+
+/**
+ * Returns a copy of t with one node holding key removed, key must be present. Descending into a black child
+ * lowers that side's black height by one, which balleft and balright restore.
+ *
+ * @param link&
+ * @param unsigned long long
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::del(const link& t, unsigned long long key)
+{
+    if (!t)
+        return link();
+
+    if (key < t->key)
+    {
+        if (isBlack(t->left))
+            return balleft(del(t->left, key), t, t->right);
+        return make(RED, del(t->left, key), t, t->right);
+    }
+
+    if (key > t->key)
+    {
+        if (isBlack(t->right))
+            return balright(t->left, t, del(t->right, key));
+        return make(RED, t->left, t, del(t->right, key));
+    }
+
+    return app(t->left, t->right);
+}
+
+/**
+ * Rebuilds a node with payload y whose left subtree l is one black level short of its right subtree r.
+ *
+ * @param link&
+ * @param link&
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::balleft(const link& l, const link& y, const link& r)
+{
+    if (isRed(l))
+        return make(RED, make(BLACK, l->left, l, l->right), y, r);
+
+    if (isBlack(r))
+        return balance(l, y, make(RED, r->left, r, r->right));
+
+    // r is red with a black left child, anything else means the tree was not balanced to begin with
+    return make(RED, make(BLACK, l, y, r->left->left), r->left, balance(r->left->right, r, sub1(r->right)));
+}
+
+/**
+ * Rebuilds a node with payload y whose right subtree r is one black level short of its left subtree l.
+ *
+ * @param link&
+ * @param link&
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::balright(const link& l, const link& y, const link& r)
+{
+    if (isRed(r))
+        return make(RED, l, y, make(BLACK, r->left, r, r->right));
+
+    if (isBlack(l))
+        return balance(make(RED, l->left, l, l->right), y, r);
+
+    // l is red with a black right child
+    return make(RED, balance(sub1(l->left), l, l->right->left), l->right, make(BLACK, l->right->right, y, r));
+}
+
+/**
+ * Builds a black node with payload y over l and r, resolving a red node with a red child on either side by
+ * turning the three nodes involved into a red parent with two black children.
+ *
+ * @param link&
+ * @param link&
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::balance(const link& l, const link& y, const link& r)
+{
+    if (isRed(l) && isRed(r))
+        return make(RED, make(BLACK, l->left, l, l->right), y, make(BLACK, r->left, r, r->right));
+
+    if (isRed(l) && isRed(l->left))
+    {
+        const link& a = l->left;
+        return make(RED, make(BLACK, a->left, a, a->right), l, make(BLACK, l->right, y, r));
+    }
+
+    if (isRed(l) && isRed(l->right))
+    {
+        const link& b = l->right;
+        return make(RED, make(BLACK, l->left, l, b->left), b, make(BLACK, b->right, y, r));
+    }
+
+    if (isRed(r) && isRed(r->right))
+    {
+        const link& d = r->right;
+        return make(RED, make(BLACK, l, y, r->left), r, make(BLACK, d->left, d, d->right));
+    }
+
+    if (isRed(r) && isRed(r->left))
+    {
+        const link& c = r->left;
+        return make(RED, make(BLACK, l, y, c->left), c, make(BLACK, c->right, r, r->right));
+    }
+
+    return make(BLACK, l, y, r);
+}
+
+/**
+ * Builds a node of the given color over l and r which carries the key and data of the node y.
+ *
+ * @param char
+ * @param link&
+ * @param link&
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::make(char color, const link& l, const link& y, const link& r)
+{
+    return link(new rbPersistentNode<T>(color, l, y->key, y->data, r));
+}
+
+/**
+ * Builds a node of the given color over l and r which carries key and data.
+ *
+ * @param char
+ * @param link&
+ * @param unsigned long long
+ * @param T*
+ * @param link&
+ * @return link
+ */
+template <class T>
+typename PersistentRBT<T>::link PersistentRBT<T>::make(char color, const link& l, unsigned long long key, T* data,
+                                                       const link& r)
+{
+    return link(new rbPersistentNode<T>(color, l, key, data, r));
+}
@@ -0,0 +1,87 @@
+#ifndef RBAUGMENT_H
+#define  RBAUGMENT_H
+
+#include <cstddef>
+#include <limits>
+
+/**
+ * Augmentation policies which can be plugged into the RBT class through its augmentation template parameter. A
+ * policy supplies the extra fields every rbNode inherits through its fields structure and an update routine which
+ * recomputes those fields for a node from the fields of its two children. The tree calls update bottom-up along
+ * every path it modifies and on both nodes touched by a rotation, so the fields are always consistent. The
+ * sentinel keeps the value-initialized fields it was created with and is never updated.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * The default policy, nodes carry no extra fields (the empty base takes no room) and no paths are walked.
+ */
+struct rbPlain
+{
+    static const bool augmented = false;
+
+    struct fields
+    {
+    };
+
+    template <class N>
+    static void update(N* n)
+    {
+    }
+};
+
+/**
+ * Order statistic policy, every node records the number of nodes in the subtree rooted at it. This allows the
+ * tree to answer select, rank and range count queries with a single root to leaf descent.
+ */
+struct rbOrderStatistic
+{
+    static const bool augmented = true;
+
+    struct fields
+    {
+        std::size_t size;
+    };
+
+    template <class N>
+    static void update(N* n)
+    {
+        n->size = n->left->size + n->right->size + 1;
+    }
+};
+
+/**
+ * Interval policy, every node holds the closed interval [key, end] and records the largest end point in the subtree
+ * rooted at it. A subtree whose largest end point lies before a query cannot overlap it, which lets findOverlapping
+ * and stab skip it entirely. update has no access to the comparator of the tree and takes the maximum with
+ * operator<, while the queries compare keys and end points with the tree's Compare, so a tree using this policy
+ * needs a Compare which orders T the same way operator< does; IntervalRBT fixes it to std::less. Both fields start
+ * out at the lowest value of T, so the sentinel never raises a maximum. Intervals have to be inserted with
+ * insertInterval, a node inserted any other way keeps the lowest value as its end.
+ */
+template <class T>
+struct rbInterval
+{
+    static const bool augmented = true;
+
+    struct fields
+    {
+        T end = std::numeric_limits<T>::lowest();
+        T maxEnd = std::numeric_limits<T>::lowest();
+    };
+
+    template <class N>
+    static void update(N* n)
+    {
+        n->maxEnd = n->end;
+
+        if (n->maxEnd < n->left->maxEnd)
+            n->maxEnd = n->left->maxEnd;
+        if (n->maxEnd < n->right->maxEnd)
+            n->maxEnd = n->right->maxEnd;
+    }
+};
+
+#endif
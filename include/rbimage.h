@@ -0,0 +1,262 @@
+#ifndef RBIMAGE_H
+#define  RBIMAGE_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define RB_IMAGE_MAGIC "RBTIMAGE"
+#define RB_IMAGE_VERSION 1
+
+// set in the flags of an image whose values were written by a caller supplied serializer
+#define RB_IMAGE_SERIALIZED 0x1u
+
+// bytes collected by the writer before they are checksummed and handed to the file
+#define RB_IMAGE_BUFFER ((std::size_t) 1 << 20)
+
+/**
+ * Support for the binary images written by RBTree::save and read back by RBTree::load. An image is a fixed header
+ * followed by a body holding every key in key order, followed by the values. Values of a trivially copyable type are
+ * stored as one array; values written by a caller supplied serializer are stored as a length followed by the bytes
+ * for every element. The body is padded to a multiple of eight bytes and covered by a checksum kept in the header,
+ * and the layout is that of the machine which wrote it, a reader on a machine with a different byte order or word
+ * size rejects the image through the version and size fields.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * Header at the start of every image.
+ */
+struct rbImageHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t flags;
+    std::uint32_t keySize;
+    std::uint32_t valueSize;
+    std::uint64_t count;
+    std::uint64_t bodySize;
+    std::uint64_t checksum;
+};
+
+/**
+ * Fletcher style checksum over 64 bit words. The two running sums only take an add each per word, which keeps
+ * verification well ahead of the disk; the second sum makes the result depend on the position of every word.
+ */
+class rbImageChecksum
+{
+    public:
+        rbImageChecksum() : a(0), b(0)
+        {
+        }
+
+        // len must be a multiple of eight except for the last call
+        void update(const char* bytes, std::size_t len)
+        {
+            std::size_t i = 0;
+
+            for (; i + 8 <= len; i += 8)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, bytes + i, 8);
+                a += word;
+                b += a;
+            }
+
+            if (i < len)
+            {
+                std::uint64_t word = 0;
+                std::memcpy(&word, bytes + i, len - i);
+                a += word;
+                b += a;
+            }
+        }
+
+        std::uint64_t value() const
+        {
+            return a ^ (b << 32 | b >> 32);
+        }
+
+    private:
+        std::uint64_t a, b;
+};
+
+/**
+ * Buffered writer for an image. The body is collected in large blocks which are checksummed and written as they
+ * fill up; finish() pads the body, writes the header in front of it and moves the file into place, so an image
+ * only ever appears at its final path once it is complete.
+ */
+class rbImageWriter
+{
+    public:
+        rbImageWriter(const std::string& path) : path(path), temp(path + ".tmp"), bodySize(0), ok(true)
+        {
+            file = std::fopen(temp.c_str(), "wb");
+            ok = file != nullptr;
+            buffer.reserve(RB_IMAGE_BUFFER);
+
+            // room for the header, which is written last
+            rbImageHeader header = rbImageHeader();
+            if (ok)
+                ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        }
+
+        ~rbImageWriter()
+        {
+            if (file != nullptr)
+            {
+                std::fclose(file);
+                std::remove(temp.c_str());
+            }
+        }
+
+        void write(const void* bytes, std::size_t len)
+        {
+            const char* from = static_cast<const char*>(bytes);
+
+            while (len > 0)
+            {
+                std::size_t chunk = std::min(len, RB_IMAGE_BUFFER - buffer.size());
+                buffer.insert(buffer.end(), from, from + chunk);
+                from += chunk;
+                len -= chunk;
+
+                if (buffer.size() == RB_IMAGE_BUFFER)
+                    flush();
+            }
+        }
+
+        bool finish(std::uint32_t flags, std::uint32_t keySize, std::uint32_t valueSize, std::uint64_t count)
+        {
+            // the temporary file could not be created, there is nothing to write, close or remove
+            if (file == nullptr)
+                return false;
+
+            static const char zeros[8] = {0};
+            write(zeros, (8 - (bodySize + buffer.size()) % 8) % 8);
+            flush();
+
+            rbImageHeader header = rbImageHeader();
+            std::memcpy(header.magic, RB_IMAGE_MAGIC, sizeof(header.magic));
+            header.version = RB_IMAGE_VERSION;
+            header.flags = flags;
+            header.keySize = keySize;
+            header.valueSize = valueSize;
+            header.count = count;
+            header.bodySize = bodySize;
+            header.checksum = checksum.value();
+
+            if (ok)
+                ok = std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+
+            ok = std::fclose(file) == 0 && ok;
+            file = nullptr;
+
+            if (ok)
+                ok = std::rename(temp.c_str(), path.c_str()) == 0;
+            if (!ok)
+                std::remove(temp.c_str());
+
+            return ok;
+        }
+
+    private:
+        std::string path;
+        std::string temp;
+        std::FILE* file;
+        std::vector<char> buffer;
+        std::uint64_t bodySize;
+        rbImageChecksum checksum;
+        bool ok;
+
+        void flush()
+        {
+            checksum.update(buffer.data(), buffer.size());
+            bodySize += buffer.size();
+
+            if (ok && !buffer.empty())
+                ok = std::fwrite(buffer.data(), buffer.size(), 1, file) == 1;
+
+            buffer.clear();
+        }
+};
+
+/**
+ * Read only memory mapping of an image. The mapping is advised for sequential access, so the kernel reads ahead
+ * while the body is checksummed and the tree is built from it, and is released when the object goes away.
+ */
+class rbMappedImage
+{
+    public:
+        rbMappedImage(const std::string& path) : base(nullptr), length(0)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return;
+
+            struct stat info;
+            if (::fstat(fd, &info) == 0 && info.st_size > 0)
+            {
+                void* mapped = ::mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+                if (mapped != MAP_FAILED)
+                {
+                    base = static_cast<const char*>(mapped);
+                    length = info.st_size;
+                    ::madvise(mapped, length, MADV_SEQUENTIAL);
+                }
+            }
+
+            ::close(fd);
+        }
+
+        ~rbMappedImage()
+        {
+            if (base != nullptr)
+                ::munmap(const_cast<char*>(base), length);
+        }
+
+        rbMappedImage(const rbMappedImage&) = delete;
+        rbMappedImage& operator=(const rbMappedImage&) = delete;
+
+        // returns the header if the file holds a complete image of the given layout whose checksum matches
+        const rbImageHeader* validate(std::uint32_t flags, std::uint32_t keySize, std::uint32_t valueSize) const
+        {
+            if (base == nullptr || length < sizeof(rbImageHeader))
+                return nullptr;
+
+            const rbImageHeader* header = reinterpret_cast<const rbImageHeader*>(base);
+
+            if (std::memcmp(header->magic, RB_IMAGE_MAGIC, sizeof(header->magic)) != 0 ||
+                header->version != RB_IMAGE_VERSION || header->flags != flags || header->keySize != keySize ||
+                header->valueSize != valueSize || header->bodySize != length - sizeof(rbImageHeader) ||
+                header->count > header->bodySize / (keySize == 0 ? 1 : keySize))
+                return nullptr;
+
+            rbImageChecksum checksum;
+            checksum.update(body(), header->bodySize);
+
+            return checksum.value() == header->checksum ? header : nullptr;
+        }
+
+        const char* body() const
+        {
+            return base + sizeof(rbImageHeader);
+        }
+
+    private:
+        const char* base;
+        std::size_t length;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef RBPOOL_H
+#define  RBPOOL_H
+
+#include <new>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+#define POOL_MIN_SLAB 64
+#define POOL_MAX_SLAB 65536
+
+/**
+ * Node allocation policies which can be plugged into the RBT class through its allocator template parameter.
+ * Each policy hands out raw, suitably aligned storage for a single node type and takes it back again. A policy
+ * that advertises bulkRelease may free every node it has ever handed out with a single release() call, which
+ * allows the tree to drop all of its nodes without walking the structure. When nodes move from one tree to another
+ * the receiving tree calls adopt or share so that its policy keeps the memory of the moved nodes alive.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * Slab (arena) allocator which carves nodes out of contiguous blocks of memory. Freed nodes are threaded onto an
+ * intrusive free list so they are reused by the next allocation before any fresh slab space is touched. Slabs
+ * grow geometrically from POOL_MIN_SLAB up to POOL_MAX_SLAB nodes and are only ever returned to the system as a
+ * whole by release() or the destructor.
+ *
+ * The slabs live in a reference counted arena. Pools which share an arena after a split, or an arena which keeps the
+ * arenas of adopted pools alive after a join, make sure no slab is freed while any tree may still hold nodes in it.
+ * Only the slab list of an arena is shared and it is guarded by a mutex, the free list and bump region belong to a
+ * single pool.
+ */
+template <class N>
+class rbNodePool
+{
+    public:
+        static const bool bulkRelease = true;
+
+        rbNodePool();
+        ~rbNodePool();
+        N* allocate();
+        void release();
+        void deallocate(N* n);
+        void reserve(std::size_t n);
+        void adopt(rbNodePool& other);
+        void share(rbNodePool& other);
+        std::size_t capacity();
+
+        rbNodePool(const rbNodePool&) = delete;
+        rbNodePool& operator=(const rbNodePool&) = delete;
+
+    private:
+        /**
+         * A single node sized slot, while a slot is unused it stores the link to the next free slot.
+         */
+        union rbSlot
+        {
+            rbSlot* next;
+            alignas(N) unsigned char storage[sizeof(N)];
+        };
+
+        /**
+         * Header placed in front of every slab so that all slabs can be chained together and freed at once.
+         */
+        struct rbSlab
+        {
+            rbSlab* next;
+            std::size_t count;
+        };
+
+        /**
+         * Owner of a list of slabs which frees them once the last pool or arena referring to it lets go.
+         */
+        struct rbArena
+        {
+            rbSlab* slabs;
+            std::mutex lock;
+            std::vector<std::shared_ptr<rbArena>> keep;
+
+            rbArena();
+            ~rbArena();
+        };
+
+        std::shared_ptr<rbArena> arena;
+        rbSlot* freeList;
+        rbSlot* bump;
+        rbSlot* bumpEnd;
+        std::size_t nextSlabSize;
+        std::size_t totalSlots;
+
+        void addSlab(std::size_t count);
+        static rbSlot* slots(rbSlab* slab);
+};
+
+/**
+ * Allocation policy which forwards every request to the global operator new and operator delete. The policy can
+ * not drop all nodes at once so the tree falls back to a depth first teardown when it is in use.
+ */
+template <class N>
+class rbHeapAllocator
+{
+    public:
+        static const bool bulkRelease = false;
+
+        N* allocate();
+        void release();
+        void deallocate(N* n);
+        void reserve(std::size_t n);
+        void adopt(rbHeapAllocator& other);
+        void share(rbHeapAllocator& other);
+        std::size_t capacity();
+};
+
+// Include templated implementation file as it is necessary to present during compile time
+#include "rbpool.tpp"
+
+#endif
@@ -0,0 +1,324 @@
+#include "rbpool.h"
+
+/**
+ * A node pool template implementation file which contains the logic for the slab allocator and the plain heap
+ * allocator policies used by the templated red black tree.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                             PUBLIC INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates an empty pool, no memory is requested until the first allocation or reservation.
+ *
+ * @return this
+ */
+template <class N>
+rbNodePool<N>::rbNodePool()
+{
+    freeList = nullptr;
+    bump = nullptr;
+    bumpEnd = nullptr;
+    nextSlabSize = POOL_MIN_SLAB;
+    totalSlots = 0;
+}
+
+/**
+ * Returns every slab owned by the pool back to the system.
+ *
+ * @return void
+ */
+template <class N>
+rbNodePool<N>::~rbNodePool()
+{
+    release();
+}
+
+/**
+ * Hands out storage for a single node. Previously freed slots are preferred over untouched slab space so that
+ * churn keeps reusing memory which is already warm in the cache. The returned storage is uninitialized.
+ *
+ * @return N*
+ */
+template <class N>
+N* rbNodePool<N>::allocate()
+{
+    if (freeList != nullptr)
+    {
+        rbSlot* s = freeList;
+        freeList = s->next;
+        return reinterpret_cast<N*>(s->storage);
+    }
+
+    if (bump == bumpEnd)
+        addSlab(nextSlabSize);
+
+    rbSlot* s = bump++;
+    return reinterpret_cast<N*>(s->storage);
+}
+
+/**
+ * Frees every slab at once. Any node previously handed out by the pool is invalid after this call, which is what
+ * allows the tree to be torn down without visiting each of its nodes. Slabs still shared with another pool stay
+ * alive until that pool releases them too.
+ *
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::release()
+{
+    arena.reset();
+
+    freeList = nullptr;
+    bump = nullptr;
+    bumpEnd = nullptr;
+    nextSlabSize = POOL_MIN_SLAB;
+    totalSlots = 0;
+}
+
+/**
+ * Pushes the storage of a node onto the free list so that the next allocation reuses it.
+ *
+ * @param N*
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::deallocate(N* n)
+{
+    rbSlot* s = reinterpret_cast<rbSlot*>(n);
+    s->next = freeList;
+    freeList = s;
+}
+
+/**
+ * Guarantees that at least n further allocations can be served without requesting more memory. Slots sitting on
+ * the free list are not counted so the reservation is always satisfied by contiguous slab space.
+ *
+ * @param size_t
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::reserve(std::size_t n)
+{
+    std::size_t available = bumpEnd - bump;
+
+    if (available >= n)
+        return;
+
+    addSlab(n);
+}
+
+/**
+ * Takes over the memory of every node handed out by other, used when all nodes of one tree are moved into another.
+ * Both arenas are kept alive by a new arena so neither side has to know about the other's slabs. The other pool is
+ * left empty and starts a fresh arena on its next allocation.
+ *
+ * @param rbNodePool&
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::adopt(rbNodePool& other)
+{
+    if (other.arena == nullptr || other.arena == arena)
+    {
+        other.release();
+        return;
+    }
+
+    if (arena == nullptr)
+        arena = other.arena;
+    else
+    {
+        std::shared_ptr<rbArena> merged = std::make_shared<rbArena>();
+        merged->keep.push_back(arena);
+        merged->keep.push_back(other.arena);
+        arena = merged;
+    }
+
+    other.release();
+}
+
+/**
+ * Starts sharing the slabs of other, used when part of another tree is moved into the empty tree owning this pool.
+ * Anything this pool held before is released.
+ *
+ * @param rbNodePool&
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::share(rbNodePool& other)
+{
+    release();
+    arena = other.arena;
+}
+
+/**
+ * Returns the total number of node slots owned by the pool, whether in use or not.
+ *
+ * @return size_t
+ */
+template <class N>
+std::size_t rbNodePool<N>::capacity()
+{
+    return totalSlots;
+}
+
+/**
+ * Allocates a single node from the global heap.
+ *
+ * @return N*
+ */
+template <class N>
+N* rbHeapAllocator<N>::allocate()
+{
+    return static_cast<N*>(::operator new(sizeof(N)));
+}
+
+/**
+ * The heap allocator does not track its nodes so there is nothing to drop in bulk.
+ *
+ * @return void
+ */
+template <class N>
+void rbHeapAllocator<N>::release()
+{
+}
+
+/**
+ * Returns a single node to the global heap.
+ *
+ * @param N*
+ * @return void
+ */
+template <class N>
+void rbHeapAllocator<N>::deallocate(N* n)
+{
+    ::operator delete(n);
+}
+
+/**
+ * Heap nodes are owned individually so nothing has to be done to take them over.
+ *
+ * @param rbHeapAllocator&
+ * @return void
+ */
+template <class N>
+void rbHeapAllocator<N>::adopt(rbHeapAllocator& other)
+{
+}
+
+/**
+ * Heap nodes are owned individually so nothing has to be done to share them.
+ *
+ * @param rbHeapAllocator&
+ * @return void
+ */
+template <class N>
+void rbHeapAllocator<N>::share(rbHeapAllocator& other)
+{
+}
+
+/**
+ * Reservations have no meaning for the heap allocator and are ignored.
+ *
+ * @param size_t
+ * @return void
+ */
+template <class N>
+void rbHeapAllocator<N>::reserve(std::size_t n)
+{
+}
+
+/**
+ * The heap allocator never holds on to spare nodes.
+ *
+ * @return size_t
+ */
+template <class N>
+std::size_t rbHeapAllocator<N>::capacity()
+{
+    return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              PRIVATE INTERFACE                                          ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Requests a new slab holding count slots and makes it the current bump region. Whatever was left of the
+ * previous bump region is moved onto the free list so it is not lost. The size of the next automatically grown
+ * slab doubles until POOL_MAX_SLAB is reached.
+ *
+ * @param size_t
+ * @return void
+ */
+template <class N>
+void rbNodePool<N>::addSlab(std::size_t count)
+{
+    while (bump != bumpEnd)
+        deallocate(reinterpret_cast<N*>((bump++)->storage));
+
+    if (arena == nullptr)
+        arena = std::make_shared<rbArena>();
+
+    rbSlab* slab = static_cast<rbSlab*>(::operator new(sizeof(rbSlab) + alignof(rbSlot) + count * sizeof(rbSlot)));
+    slab->count = count;
+
+    {
+        std::lock_guard<std::mutex> guard(arena->lock);
+        slab->next = arena->slabs;
+        arena->slabs = slab;
+    }
+
+    bump = slots(slab);
+    bumpEnd = bump + count;
+    totalSlots += count;
+
+    if (nextSlabSize < POOL_MAX_SLAB)
+        nextSlabSize *= 2;
+}
+
+/**
+ * Creates an arena without any slabs.
+ *
+ * @return this
+ */
+template <class N>
+rbNodePool<N>::rbArena::rbArena()
+{
+    slabs = nullptr;
+}
+
+/**
+ * Frees every slab of the arena, arenas it keeps alive are released along with it.
+ *
+ * @return void
+ */
+template <class N>
+rbNodePool<N>::rbArena::~rbArena()
+{
+    while (slabs != nullptr)
+    {
+        rbSlab* next = slabs->next;
+        ::operator delete(slabs);
+        slabs = next;
+    }
+}
+
+/**
+ * Returns the first slot of a slab, which sits just past the header rounded up to the slot alignment.
+ *
+ * @param rbSlab*
+ * @return rbSlot*
+ */
+template <class N>
+typename rbNodePool<N>::rbSlot* rbNodePool<N>::slots(rbSlab* slab)
+{
+    std::size_t offset = sizeof(rbSlab) + alignof(rbSlot) - 1;
+    offset -= offset % alignof(rbSlot);
+    return reinterpret_cast<rbSlot*>(reinterpret_cast<unsigned char*>(slab) + offset);
+}
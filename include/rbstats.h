@@ -0,0 +1,172 @@
+#ifndef RBSTATS_H
+#define  RBSTATS_H
+
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <cstdio>
+
+// number of buckets of the search depth histogram, deeper searches are counted in the last bucket
+#ifndef RB_STATS_DEPTHS
+#define RB_STATS_DEPTHS 64
+#endif
+
+/**
+ * Operation statistics and shape of a red black tree, as returned by RBTree::stats(). The operation counters are
+ * only maintained when RBT_STATS is defined before rbt.h is included; without it they stay zero, counting is
+ * false and the tree carries no counting code at all. The shape fields are computed on demand in either case.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * A copy of the counters together with the shape of the tree at the time it was taken. The fixup case numbers
+ * follow 'Introduction to Algorithms': insertion case 1 only recolors, case 2 rotates the new node to the outside
+ * and case 3 rotates the grandparent; deletion case 1 has a red sibling, case 2 a black sibling with two black
+ * children, case 3 a black sibling whose far child is black and case 4 a black sibling whose far child is red.
+ * Each entry counts loop iterations which took that case, mirror images included. The depth of a search is the
+ * number of nodes it compared against.
+ */
+struct rbStats
+{
+    bool counting;
+    unsigned long long leftRotations;
+    unsigned long long rightRotations;
+    unsigned long long insertFixups;
+    unsigned long long insertCases[3];
+    unsigned long long deleteFixups;
+    unsigned long long deleteCases[4];
+    unsigned long long searchHits;
+    unsigned long long searchMisses;
+    unsigned long long searchDepths[RB_STATS_DEPTHS];
+
+    std::size_t nodeCount;
+    std::size_t height;
+    std::size_t blackHeight;
+    double averageDepth;
+
+    std::string toText() const
+    {
+        std::string out;
+        char line[256];
+
+        std::snprintf(line, sizeof(line), "nodes %zu, height %zu, black height %zu, average depth %.2f\n",
+            nodeCount, height, blackHeight, averageDepth);
+        out += line;
+
+        if (!counting)
+            return out + "operation counters disabled, define RBT_STATS to enable them\n";
+
+        std::snprintf(line, sizeof(line), "rotations: left %llu, right %llu\n", leftRotations, rightRotations);
+        out += line;
+        std::snprintf(line, sizeof(line), "insert fixups %llu: case 1 %llu, case 2 %llu, case 3 %llu\n",
+            insertFixups, insertCases[0], insertCases[1], insertCases[2]);
+        out += line;
+        std::snprintf(line, sizeof(line), "delete fixups %llu: case 1 %llu, case 2 %llu, case 3 %llu, case 4 %llu\n",
+            deleteFixups, deleteCases[0], deleteCases[1], deleteCases[2], deleteCases[3]);
+        out += line;
+        std::snprintf(line, sizeof(line), "searches: hits %llu, misses %llu\nsearch depths:", searchHits,
+            searchMisses);
+        out += line;
+
+        for (int d = 0; d < RB_STATS_DEPTHS; d++)
+        {
+            if (searchDepths[d] != 0)
+            {
+                std::snprintf(line, sizeof(line), " %d%s:%llu", d, d == RB_STATS_DEPTHS - 1 ? "+" : "",
+                    searchDepths[d]);
+                out += line;
+            }
+        }
+
+        return out + "\n";
+    }
+
+    std::string toJson() const
+    {
+        std::string out;
+        char line[1024];
+
+        std::snprintf(line, sizeof(line), "{\"nodeCount\": %zu, \"height\": %zu, \"blackHeight\": %zu, "
+            "\"averageDepth\": %.4f, \"counting\": %s", nodeCount, height, blackHeight, averageDepth,
+            counting ? "true" : "false");
+        out += line;
+
+        std::snprintf(line, sizeof(line), ", \"leftRotations\": %llu, \"rightRotations\": %llu, \"insertFixups\": "
+            "%llu, \"insertCases\": [%llu, %llu, %llu], \"deleteFixups\": %llu, \"deleteCases\": [%llu, %llu, %llu, "
+            "%llu], \"searchHits\": %llu, \"searchMisses\": %llu, \"searchDepths\": [", leftRotations,
+            rightRotations, insertFixups, insertCases[0], insertCases[1], insertCases[2], deleteFixups,
+            deleteCases[0], deleteCases[1], deleteCases[2], deleteCases[3], searchHits, searchMisses);
+        out += line;
+
+        for (int d = 0; d < RB_STATS_DEPTHS; d++)
+        {
+            std::snprintf(line, sizeof(line), d ? ", %llu" : "%llu", searchDepths[d]);
+            out += line;
+        }
+
+        return out + "]}";
+    }
+};
+
+/**
+ * The live counters kept by a tree built with RBT_STATS. They are relaxed atomics because searches update them
+ * from concurrent readers (ShardedRBT takes its locks shared for lookups) and the parallel set operations rotate
+ * disjoint subtrees of the same tree from several threads.
+ */
+struct rbStatCounters
+{
+    std::atomic<unsigned long long> leftRotations;
+    std::atomic<unsigned long long> rightRotations;
+    std::atomic<unsigned long long> insertFixups;
+    std::atomic<unsigned long long> insertCases[3];
+    std::atomic<unsigned long long> deleteFixups;
+    std::atomic<unsigned long long> deleteCases[4];
+    std::atomic<unsigned long long> searchHits;
+    std::atomic<unsigned long long> searchMisses;
+    std::atomic<unsigned long long> searchDepths[RB_STATS_DEPTHS];
+
+    rbStatCounters()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        leftRotations = rightRotations = insertFixups = deleteFixups = searchHits = searchMisses = 0;
+
+        for (int i = 0; i < 3; i++)
+            insertCases[i] = 0;
+        for (int i = 0; i < 4; i++)
+            deleteCases[i] = 0;
+        for (int d = 0; d < RB_STATS_DEPTHS; d++)
+            searchDepths[d] = 0;
+    }
+
+    void copyTo(rbStats& s) const
+    {
+        s.counting = true;
+        s.leftRotations = leftRotations;
+        s.rightRotations = rightRotations;
+        s.insertFixups = insertFixups;
+        s.deleteFixups = deleteFixups;
+        s.searchHits = searchHits;
+        s.searchMisses = searchMisses;
+
+        for (int i = 0; i < 3; i++)
+            s.insertCases[i] = insertCases[i];
+        for (int i = 0; i < 4; i++)
+            s.deleteCases[i] = deleteCases[i];
+        for (int d = 0; d < RB_STATS_DEPTHS; d++)
+            s.searchDepths[d] = searchDepths[d];
+    }
+};
+
+#ifdef RBT_STATS
+#define RB_COUNT(counter) counters.counter.fetch_add(1, std::memory_order_relaxed)
+#else
+#define RB_COUNT(counter)
+#endif
+
+#endif
@@ -2,10 +2,29 @@
 #define  RBT_H
 
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <utility>
 #include <iostream>
+#include <iterator>
+#include <functional>
+#include "rbpool.h"
+#include "rbaugment.h"
+#include "rbimage.h"
+#include "rbstats.h"
 
 #define SPACE_COUNT 10
 
+// number of lookups searchBatch and containsBatch keep in flight at once
+#ifndef BATCH_GROUP
+#define BATCH_GROUP 24
+#endif
+
+// subtrees with a smaller black height than this are never handed to another thread by the set operations
+#ifndef PARALLEL_GRAIN
+#define PARALLEL_GRAIN 10
+#endif
+
 /**
  * A red black tree header file containing all appropriate declarations.
  *
@@ -23,64 +42,236 @@ enum rbColor
 };
 
 /**
- * Templated node structure that allows a generic type to be stored under the attribute data. The key attribute
- * is implemented as an unsigned long long and is left up to the developer for which the key represents. The nodes will be 
- * inserted into the red black tree using this field.
+ * Templated node structure that stores a value of generic type inline under the attribute data, so reaching the
+ * value costs no further indirection and no separate allocation. The key attribute is of a generic type as well
+ * and is left up to the developer for which the key represents. The nodes will be inserted into the red black
+ * tree using this field. Any extra per node fields required by the augmentation policy (see rbaugment.h) are
+ * inherited from the policy, the default policy adds none.
  */
-template <typename T>
-struct rbNode
+template <class Key, class Value, class Aug = rbPlain>
+struct rbTreeNode : public Aug::fields
 {
-    T* data;
+    Value data;
     char rbColor;
-    unsigned long long key;
-    rbNode* left, *right, *parent;
+    Key key;
+    rbTreeNode* left, *right, *parent;
+
+    rbTreeNode();
+    template <class... Args>
+    rbTreeNode(const Key& key, Args&&... args);
 };
 
 /**
- * A red black tree class definition that is based off of the rbNode structure defined above.
+ * The original node layout, an unsigned long long key and a pointer to data owned by the caller.
  */
-template <class T>
-class RBT
+template <typename T, class Aug = rbPlain>
+using rbNode = rbTreeNode<unsigned long long, T*, Aug>;
+
+/**
+ * Bidirectional iterator over the nodes of a red black tree in key order. Successors and predecessors are found by
+ * following the parent pointers of the nodes, so stepping never recurses and needs no auxiliary stack. The
+ * sentinel acts as the past-the-end position; since the tree keeps the sentinel's left pointer on the root,
+ * decrementing the end iterator lands on the maximum.
+ */
+template <class N>
+class rbIterator
+{
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef N value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef N* pointer;
+        typedef N& reference;
+
+        rbIterator();
+        rbIterator(N* node, N* sentinel);
+        N* get() const;
+        N& operator*() const;
+        N* operator->() const;
+        rbIterator& operator++();
+        rbIterator& operator--();
+        rbIterator operator++(int);
+        rbIterator operator--(int);
+        bool operator==(const rbIterator& other) const;
+        bool operator!=(const rbIterator& other) const;
+
+    private:
+        N* node;
+        N* sentinel;
+};
+
+template <class Key, class Value, class Compare>
+class FrozenRBT;
+
+/**
+ * A red black tree class definition that is based off of the rbTreeNode structure defined above. Keys are ordered
+ * by Compare and values are stored inside the nodes; both have to be default constructible for the sentinel, and
+ * values may be move only. Nodes are obtained from the Alloc policy (see rbpool.h), which defaults to a slab pool
+ * owned by the tree, and carry the fields of the Aug policy (see rbaugment.h), which defaults to no augmentation.
+ */
+template <class Key, class Value, class Compare = std::less<Key>, template <class> class Alloc = rbNodePool,
+    class Aug = rbPlain>
+class RBTree
 {
     public:
-        RBT();
-        ~RBT();
+        typedef rbTreeNode<Key, Value, Aug> node;
+        typedef rbIterator<node> iterator;
+
+        ~RBTree();
+        template <class It>
+        RBTree(It first, It last);
+        RBTree(const Compare& comp = Compare());
+        iterator end();
+        iterator begin();
+        void clear();
+        rbStats stats();
+        void resetStats();
         bool isEmpty();
+        std::size_t size();
+        void join(RBTree& right);
+        FrozenRBT<Key, Value, Compare> freeze();
+        void unionWith(RBTree& other);
+        void intersectWith(RBTree& other);
+        void differenceWith(RBTree& other);
+        void setParallelism(unsigned threads);
+        void split(const Key& key, RBTree& right);
         void inorder();
         void preorder();
         void postorder();
-        rbNode<T>* min();
-        rbNode<T>* max();
+        node* min();
+        node* max();
+        node* peekMin();
+        node* peekMax();
+        std::size_t rank(const Key& key);
+        node* select(std::size_t k);
         void prettyPrint();
-        rbNode<T>* getRoot();
-        rbNode<T>* getSentinel();
-        bool del(unsigned long long key);
-        rbNode<T>* search(unsigned long long key);
-        void insert(unsigned long long key, T* data);
+        void reserve(std::size_t n);
+        node* getRoot();
+        node* getSentinel();
+        bool del(const Key& key);
+        bool erase(node* z);
+        template <class P>
+        std::size_t eraseIf(P pred);
+        std::size_t eraseRange(const Key& lo, const Key& hi);
+        bool popMin(Key& key, Value& data);
+        bool popMax(Key& key, Value& data);
+        bool load(const std::string& path);
+        bool save(const std::string& path);
+        iterator find(const Key& key);
+        std::size_t countRange(const Key& lo, const Key& hi);
+        node* search(const Key& key);
+        void insert(const Key& key, Value data);
+        iterator append(const Key& key, Value data);
+        iterator lower_bound(const Key& key);
+        iterator upper_bound(const Key& key);
+        template <class It>
+        void insertBatch(It first, It last);
+        template <class It>
+        void buildFromSorted(It first, It last);
+        template <class F>
+        void forEachInRange(const Key& lo, const Key& hi, F fn);
+        template <class F>
+        void stab(const Key& point, F fn);
+        template <class F>
+        void findOverlapping(const Key& lo, const Key& hi, F fn);
+        iterator insertInterval(const Key& start, const Key& end, Value data);
+        void containsBatch(const Key* keys, std::size_t n, bool* out);
+        void searchBatch(const Key* keys, std::size_t n, node** out);
+        template <class D>
+        bool load(const std::string& path, D deserialize);
+        template <class S>
+        bool save(const std::string& path, S serialize);
+        template <class... Args>
+        iterator emplace(const Key& key, Args&&... args);
+        iterator insert(iterator hint, const Key& key, Value data);
+        template <class M>
+        std::pair<iterator, bool> insert_or_assign(const Key& key, M&& value);
+        template <class... Args>
+        std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args);
         
     private:
-        rbNode<T>* root;
-        rbNode<T>* sentinel;
-
-        void pdel(rbNode<T>* x);
-        void leftRotate(rbNode<T>* x);
-        void inorder(rbNode<T>* root);
-        void preorder(rbNode<T>* root);
-        void rightRotate(rbNode<T>* y);
-        void postorder(rbNode<T>* root);
-        rbNode<T>* pmin(rbNode<T>* root);
-        rbNode<T>* pmax(rbNode<T>* root);
-        void deleteTree(rbNode<T>* root);
-        void rbTransplant(rbNode<T>* u, rbNode<T>* v);
-        void pdelFixup(rbNode<T>* &root, rbNode<T>* &ptr);
-        rbNode<T>* pinsert(rbNode<T>* root, rbNode<T>* ptr);
-        void pinsertFixup(rbNode<T>* &root, rbNode<T>* &ptr);
-        rbNode<T>* instantiateNode(unsigned long long key, T* data);
-        rbNode<T>* psearch(rbNode<T>* root, unsigned long long key);
-        void pprint(rbNode<T>* root, std::string indent, bool last);
+        node* root;
+        node* sentinel;
+        node* leftmost;
+        node* rightmost;
+        std::size_t nodeCount;
+        unsigned parallelism;
+        Compare comp;
+        Alloc<node> nodes;
+#ifdef RBT_STATS
+        rbStatCounters counters;
+#endif
+
+        int forkDepth();
+        void pdel(node* x);
+        void inorder(node* root);
+        void preorder(node* root);
+        void postorder(node* root);
+        node* pmin(node* root);
+        node* pmax(node* root);
+        std::size_t deleteTree(node* root);
+        void leftRotate(node* x, node* &top);
+        void rightRotate(node* y, node* &top);
+        void refreshEnds();
+        void attach(node* ptr, node* from);
+        void destroyNode(node* n);
+        void augmentPath(node* n);
+        void relink(std::vector<node*>& order);
+        std::vector<node*> pwriteKeys(rbImageWriter& out);
+        std::size_t countBelow(const Key& key, bool inclusive);
+        void rbTransplant(node* u, node* v);
+        void pdelFixup(node* &root, node* &ptr);
+        void pinsert(node* from, node* ptr);
+        node* pfinger(node* hint, const Key& key);
+        void pinsertFixup(node* &root, node* &ptr);
+        template <class F>
+        void pbatch(const Key* keys, std::size_t n, F finish);
+        template <class F>
+        void poverlap(node* n, const Key& lo, const Key& hi, F& fn);
+        template <class P>
+        void ppartition(node* n, P& pred, std::vector<node*>& keep, std::vector<node*>& drop);
+        template <class F>
+        bool prestore(const char* keys, std::size_t count, F next);
+        template <class... Args>
+        node* instantiateNode(const Key& key, Args&&... args);
+        node* psearch(node* root, const Key& key);
+        void pprint(node* root, std::string indent, bool last);
+        node* pbuild(node** order, std::size_t count, std::size_t depth, std::size_t fullDepth, node* parent);
+        std::size_t blackHeight(node* n, node* leaf);
+        void pshape(node* n, std::size_t depth, std::size_t& height, double& depthSum);
+        node* pjoin2(node* l, node* r);
+        node* psplitLast(node* t, node* &rest);
+        node* pjoin(node* l, node* k, node* r);
+        std::size_t pretarget(node* n, node* from, int depth);
+        node* punion(node* a, node* b, int depth);
+        void psplit(node* t, const Key& key, bool inclusive, node* &l, node* &r);
+        node* pintersect(node* a, node* b, node* leaf, int depth, std::vector<node*>& garbage);
+        node* pdifference(node* a, node* b, node* leaf, int depth, std::vector<node*>& garbage);
 };
 
+/**
+ * The original tree, keyed by unsigned long long and holding a pointer to data owned by the caller.
+ */
+template <class T, template <class> class Alloc = rbNodePool, class Aug = rbPlain>
+using RBT = RBTree<unsigned long long, T*, std::less<unsigned long long>, Alloc, Aug>;
+
+/**
+ * Red black tree which maintains subtree sizes so that select, rank and countRange run in O(log n).
+ */
+template <class T>
+using OrderStatisticRBT = RBT<T, rbNodePool, rbOrderStatistic>;
+
+/**
+ * Interval tree, each node holds the closed interval [key, end] so overlap and stabbing queries skip every subtree
+ * which ends too early.
+ */
+template <class Key, class Value>
+using IntervalRBT = RBTree<Key, Value, std::less<Key>, rbNodePool, rbInterval<Key>>;
+
 // Include templated implementation file as it is necessary to present during compile time
 #include "rbt.tpp"
 
+// The read only layout produced by freeze()
+#include "frozenrbt.h"
+
 #endif
\ No newline at end of file
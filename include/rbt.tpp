@@ -1,4 +1,11 @@
 #include "rbt.h"
+#include <thread>
+#include <future>
+#include <iterator>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
 
 /**
  * A red black tree template implementation file which contains the logic for a templated red black tree. This 
@@ -14,19 +21,22 @@
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
- * Implicitly instantiates the sentinel rbNode object and populates the fields with invalid indicators and assigns
- * the root to be equal to the sentinel.
+ * Implicitly instantiates the sentinel node, whose key and value are default constructed and never looked at, and
+ * assigns the root to be equal to the sentinel. Keys are ordered by the given comparator.
  *
+ * @param Compare&
  * @return this
  */
-template <class T>
-RBT<T>::RBT()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+RBTree<Key, Value, Compare, Alloc, Aug>::RBTree(const Compare& comp) : comp(comp)
 {
-    sentinel = new rbNode<T>;
+    sentinel = new node();
     root = sentinel;
+    leftmost = sentinel;
+    rightmost = sentinel;
+    nodeCount = 0;
+    parallelism = std::thread::hardware_concurrency();
     
-    sentinel->key = -1;
-    sentinel->data = nullptr;
     sentinel->rbColor = BLACK;
     
     sentinel->left = root;
@@ -35,40 +45,114 @@ RBT<T>::RBT()
 }
 
 /**
- * Calls the private interface to free the entire tree from memory and removes the memory containing the sentinel
- * structure.
+ * Builds the tree from a range of (key, data) pairs already sorted by key, see buildFromSorted.
+ *
+ * @param It
+ * @param It
+ * @return this
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class It>
+RBTree<Key, Value, Compare, Alloc, Aug>::RBTree(It first, It last) : RBTree()
+{
+    buildFromSorted(first, last);
+}
+
+/**
+ * Releases every node held by the tree and removes the memory containing the sentinel structure.
  * 
  * @return void
  */
-template <class T>
-RBT<T>::~RBT()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+RBTree<Key, Value, Compare, Alloc, Aug>::~RBTree()
 {
-    deleteTree(root);
+    clear();
     
     delete sentinel;
 }
 
+/**
+ * Removes every element from the tree. When the allocator policy supports bulk release and the nodes need no
+ * destructor the node slabs are dropped as a whole, otherwise the private interface is called to destroy the tree
+ * node by node first.
+ * 
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::clear()
+{
+    if (!Alloc<node>::bulkRelease || !std::is_trivially_destructible<node>::value)
+        deleteTree(root);
+
+    if (Alloc<node>::bulkRelease)
+        nodes.release();
+
+    root = sentinel;
+    leftmost = sentinel;
+    rightmost = sentinel;
+    nodeCount = 0;
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Returns an iterator positioned past the largest key, which is represented by the sentinel.
+ * 
+ * @return iterator
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator RBTree<Key, Value, Compare, Alloc, Aug>::end()
+{
+    return iterator(sentinel, sentinel);
+}
+
+/**
+ * Returns an iterator positioned on the smallest key, or the end iterator when the tree is empty.
+ * 
+ * @return iterator
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator RBTree<Key, Value, Compare, Alloc, Aug>::begin()
+{
+    if (root == sentinel)
+        return end();
+    return iterator(pmin(root), sentinel);
+}
+
 /**
  * Returns true if there are no element remaining within the tree.
  * 
  * @return bool
  */ 
-template <class T>
-bool RBT<T>::isEmpty()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::isEmpty()
 {
     if (root == sentinel)
         return true;
     return false;
 }
 
+/**
+ * Returns the number of elements currently stored in the tree.
+ * 
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::size()
+{
+    return nodeCount;
+}
+
 /**
  * Public wrapper that injects the root into the private interface that prints out the inorder tree traversal 
  * with color.
  * 
  * @return void
  */
-template <class T>
-void RBT<T>::inorder()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::inorder()
 {
     inorder(this->root);
     std::cout << std::endl;
@@ -80,8 +164,8 @@ void RBT<T>::inorder()
  * 
  * @return void
  */
-template<class T>
-void RBT<T>::preorder()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::preorder()
 {
     preorder(this->root);
     std::cout << std::endl;
@@ -93,33 +177,143 @@ void RBT<T>::preorder()
  * 
  * @return void 
  */
-template <class T>
-void RBT<T>::postorder()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::postorder()
 {
     postorder(this->root);
     std::cout << std::endl;
 }
 
 /**
- * Public wrapper that injects the root into the private interface to search for the minimum key value.
+ * Returns the node holding the minimum key value, or the sentinel if the tree is empty, see peekMin.
  *  
- * @return rbNode<T>*
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::min()
+{
+    return leftmost;
+}
+
+/**
+ * Returns the node holding the maximum key value, or the sentinel if the tree is empty, see peekMax.
+ *
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::max()
+{
+    return rightmost;
+}
+
+/**
+ * Returns the first node in key order, or the sentinel if the tree is empty, in O(1). The tree keeps its smallest
+ * node cached through every insertion and deletion, so a tree used as a priority queue never walks down to find
+ * its front. Among duplicates of the smallest key this is the first of them in key order, the one popMin removes.
+ *
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::peekMin()
+{
+    return leftmost;
+}
+
+/**
+ * Returns the last node in key order, or the sentinel if the tree is empty, in O(1).
+ *
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::peekMax()
+{
+    return rightmost;
+}
+
+/**
+ * Moves the key and value of the first node in key order into key and data and removes the node. The smallest node
+ * has no left child, so it is unlinked without a search and without looking for a successor. Returns false and
+ * leaves key and data untouched if the tree is empty.
+ *
+ * @param Key&
+ * @param Value&
+ * @return bool
  */
-template <class T>
-rbNode<T>* RBT<T>::min()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::popMin(Key& key, Value& data)
 {
-    return pmin(root);
+    if (leftmost == sentinel)
+        return false;
+
+    key = std::move(leftmost->key);
+    data = std::move(leftmost->data);
+    return erase(leftmost);
 }
 
 /**
- * Public wrapper that injects the root into the private interface to search for the maximum key value.
+ * Moves the key and value of the last node in key order into key and data and removes the node. Returns false and
+ * leaves key and data untouched if the tree is empty.
  *
- * @return rbNode<T>*
+ * @param Key&
+ * @param Value&
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::popMax(Key& key, Value& data)
+{
+    if (rightmost == sentinel)
+        return false;
+
+    key = std::move(rightmost->key);
+    data = std::move(rightmost->data);
+    return erase(rightmost);
+}
+
+/**
+ * Returns the number of keys in the tree which are strictly less than the given key. Requires the order statistic
+ * augmentation.
+ * 
+ * @param Key&
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::rank(const Key& key)
+{
+    return countBelow(key, false);
+}
+
+/**
+ * Returns the node holding the k-th smallest key, counting from 1, or the sentinel if k is zero or larger than
+ * the number of keys in the tree. Each step compares k with the size of the left subtree to decide whether the
+ * answer is the current node or lies to its left or right, so the descent is O(log n). Requires the order
+ * statistic augmentation.
+ * 
+ * @param size_t
+ * @return node*
  */
-template <class T>
-rbNode<T>* RBT<T>::max()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::select(std::size_t k)
 {
-    return pmax(root);
+    static_assert(std::is_base_of<rbOrderStatistic::fields, node>::value,
+        "select requires the rbOrderStatistic augmentation");
+
+    node* n = root;
+
+    while (n != sentinel)
+    {
+        std::size_t r = n->left->size + 1;
+
+        if (k == r)
+            return n;
+        else if (k < r)
+            n = n->left;
+        else
+        {
+            k -= r;
+            n = n->right;
+        }
+    }
+    return sentinel;
 }
 
 /**
@@ -127,34 +321,47 @@ rbNode<T>* RBT<T>::max()
  * 
  * @return void
  */
-template <class T>
-void RBT<T>::prettyPrint() 
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::prettyPrint() 
 {
 	if (this->root)
     	pprint(this->root, "", true);
 }
 
 /**
- * Public wrapper for retrieving the root rbNode<T> structure for possible custom use cases with traversing the
+ * Asks the allocator policy to set aside room for at least n further nodes so that a known number of insertions
+ * can proceed without any further requests to the system allocator.
+ * 
+ * @param size_t
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::reserve(std::size_t n)
+{
+    nodes.reserve(n);
+}
+
+/**
+ * Public wrapper for retrieving the root node structure for possible custom use cases with traversing the
  * tree or updating the tree. If this is desired, it must be warned that the user must express an abundance of 
  * caution and should follow the mechanisms used through the public and private interface.
  * 
- * @return rbNode<T>*
+ * @return node*
  */
-template <class T>
-rbNode<T>* RBT<T>::getRoot()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::getRoot()
 {
     return this->root;
 }
 
 /**
- * Public wrapper for retrieving the sentinel rbNode<T> structure for possible custom uses with traversing root
+ * Public wrapper for retrieving the sentinel node structure for possible custom uses with traversing root
  * node and is necessary to have access to the sentinel in this scenario.
  * 
- * @return rbNode<T>*
+ * @return node*
  */
-template<class T>
-rbNode<T>* RBT<T>::getSentinel()
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::getSentinel()
 {
     return this->sentinel;
 }
@@ -163,18 +370,37 @@ rbNode<T>* RBT<T>::getSentinel()
  * Public wrapper that searches for the specified key and if found will initiate the deletion sequence and return
  * true when finished. If the key isn't in the tree then the method returns false.
  * 
- * @param unsigned long long
+ * @param Key&
  * @return bool
  */
-template <class T>
-bool RBT<T>::del(unsigned long long key)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::del(const Key& key)
 {
-    rbNode<T>* z = search(key);
+    return erase(search(key));
+}
 
+/**
+ * Deletes the given node of this tree directly, without searching for its key, which also removes exactly that
+ * node when several share the key. Passing the sentinel does nothing and returns false. The node must not be used
+ * afterwards.
+ * 
+ * @param node*
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::erase(node* z)
+{
     if (z == sentinel)
         return false;
+
+    // the end nodes lack a child on the outer side, so their neighbour is in the inner subtree or else the parent
+    if (z == leftmost)
+        leftmost = z->right != sentinel ? pmin(z->right) : z->parent;
+    if (z == rightmost)
+        rightmost = z->left != sentinel ? pmax(z->left) : z->parent;
     
     pdel(z);
+    nodeCount--;
 
     sentinel->left = root;
     sentinel->right = root;
@@ -184,748 +410,2831 @@ bool RBT<T>::del(unsigned long long key)
 }
 
 /**
- * Public wrapper for searching through the tree structure for some key and will return the appropriate rbNode<T>*
- * structure. If the structure does not exist, the function will return the sentinel structure.
+ * Removes every node whose key lies in the half open range [lo, hi) and returns how many were removed. The range is
+ * cut out of the tree with two splits and the remainder is joined back together, which costs O(log n) however many
+ * keys the range holds, with no fixup per removed node. The nodes of the detached subtree are then destroyed and
+ * handed back to the allocator one at a time by deleteTree, since the pool can only drop its slabs as a whole; only
+ * a range covering the whole tree goes through clear, which releases the slabs at once.
  * 
- * @param unsigned long long
- * @return rbNode<T>*
- */
-template <class T>
-rbNode<T>* RBT<T>::search(unsigned long long key)
-{
-    return psearch(root, key);
-}
-
-/**
- * Public wrapper for inserting some generic data type, T by creating a rbNode<T> structure containing the data
- * and respective key. Once the structure is created a private interface insert is called to insert the node in
- * the proper location. The tree will be updated to make sure the red black tree properties persist after
- * the insertion. Finally the sentinel structure will have its left & right pointers reset once the tree root
- * has been initialized.
- *
- * @param unsigned long long
- * @param T
- * @return void
+ * @param Key&
+ * @param Key&
+ * @return size_t
  */
-template <class T>
-void RBT<T>::insert(unsigned long long key, T* data)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::eraseRange(const Key& lo, const Key& hi)
 {
-    bool init = false;
-    
-    // only true in initialization case 
-    if (root == sentinel)
-        init = true;
-    
-    // instantiate rbNode<T>* with defaults
-    rbNode<T> *ptr = instantiateNode(key, data);
+    if (root == sentinel || !comp(lo, hi))
+        return 0;
 
-    // add ptr to tree
-    root = pinsert(root, ptr);
-    
-    // Init is the deterministic condition
-    if (init)
+    if (!comp(leftmost->key, lo) && comp(rightmost->key, hi))
     {
-        sentinel->left = root;
-        sentinel->right = root;
-        sentinel->parent = root;
+        std::size_t count = nodeCount;
+        clear();
+        return count;
     }
 
-    // rotate and recolor tree
-    pinsertFixup(root, ptr);
+    node* l;
+    node* rest;
+    node* range;
+    node* r;
+    psplit(root, lo, false, l, rest);
+    psplit(rest, hi, false, range, r);
+
+    root = pjoin2(l, r);
+    if (root != sentinel)
+        root->rbColor = BLACK;
+
+    std::size_t count = range == sentinel ? 0 : deleteTree(range);
+    nodeCount -= count;
+    refreshEnds();
 
     sentinel->left = root;
     sentinel->right = root;
     sentinel->parent = root;
-}
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-////                                              PRIVATE INTERFACE                                          ////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    return count;
+}
 
 /**
- * The red black tree deletion procedure is an extension to the basic binary tree 
- * deletion with the following additions. We maintain node y as the node either removed
- * from the tree or moved within the tree. We need to save y's original color in both cases
- * in order to test it at the end where if it was black, then removing or moving y could cause
- * violations of the red-black properties. We also track node x that moves into node y's original
- * position. We also always set x.p to point to the original position in the tree of y's parent even 
- * if x is, in fact, the sentinel. Finally, if node y was black, we might have introduced violations
- * of red-black properties so we call pdelFixup to restore red-black properties.
+ * Removes every node for which pred(node*) returns true and returns how many were removed. The predicate sees all
+ * nodes in key order before anything is removed, so it may not change the tree. When few nodes match they are
+ * erased one by one without a search; otherwise the remaining nodes are relinked bottom-up in linear time, like a
+ * large insertBatch, instead of running a deletion fixup for each removed node. Remaining nodes are relinked rather
+ * than reallocated, so pointers to them stay valid.
  * 
- * @param rbNode<T>*
- * @return void
+ * @param P
+ * @return size_t
  */
-template <class T>
-void RBT<T>::pdel(rbNode<T>* z)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class P>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::eraseIf(P pred)
 {
-    rbNode<T>* x;
-    rbNode<T>* y = z;
-    rbColor yOrig = (rbColor) y->rbColor;
+    std::vector<node*> order;
+    std::vector<node*> garbage;
+    order.reserve(nodeCount);
 
-    if (z->left == sentinel) // no children or only right
-    {
-        // x contains right subtree which needs to be transplanted to move out z
-        x = z->right;
-        rbTransplant(z, z->right);
-    }
-    else if (z->right == sentinel) // only left child
+    ppartition(root, pred, order, garbage);
+
+    if (order.empty())
     {
-        // x contains left subtree which needs to be transplanted to move out z
-        x = z->left;
-        rbTransplant(z, z->left);
+        clear();
+        return garbage.size();
     }
-    else // both children
-    {
-        // Get z's successor which will move into z's position in the tree
-        y = pmin(z->right);
-        yOrig = (rbColor) y->rbColor;
-        x = y->right;
-        
-        /* When y's original parent is z, we do not want x's parent to point to the node
-         * being removed from the tree. Because node y will move up to take z's position in
-         * the tree, setting x's parent to y causes x.p to point to the original position of 
-         * y's parent, even if x == sentinel.
-         */
-        if (y->parent == z)
-            x->parent = y;
-        else
-        {
-            /*
-             * Otherwise, notice that x's parent is always set via the rbTransplant function.
-             */
-            rbTransplant(y, y->right);
 
-            // reconfigure y's right pointers based on z
-            y->right = z->right;
-            y->right->parent = y;
-        }
-        // transplant z with y
-        rbTransplant(z, y);
+    std::size_t height = 0;
+    for (std::size_t n = nodeCount; n > 0; n >>= 1)
+        height++;
 
-        // reconfigure y's left pointers and color based on z
-        y->left = z->left;
-        y->left->parent = y;
-        y->rbColor = z->rbColor;
+    // k deletions of about log n steps each beat relinking all n nodes
+    if (garbage.size() * height < nodeCount)
+    {
+        for (std::size_t i = 0; i < garbage.size(); i++)
+            erase(garbage[i]);
+        return garbage.size();
     }
 
-    /* 
-     * If the original color of y was black, we might have introduced one or more violations
-     * of the red-black properties. If y was red, the red-black properties still hold when
-     * y is removed or moved for the following reasons:
-     *  1. No black-heights in the tree have changed
-     *  2. No red nodes have been made adjacent. Because y takes z's place in the tree, along
-     *  with z's color, we cannot have two adjacent red nodes at y's new position in the tree.
-     *      - In addition, if y was not z's right child, then y's original right child x replaces
-     *      y in the tree. If y is red, then x must be black, and so replacing y by x cannot 
-     *      cause two red nodes to become adjacent.
-     *  3. Since y could not have been the root if it was red, the root remains black.
-     */
-    if (yOrig == BLACK)
-        pdelFixup(this->root, x);
-    
-    delete z;
+    for (std::size_t i = 0; i < garbage.size(); i++)
+        destroyNode(garbage[i]);
+
+    relink(order);
+    return garbage.size();
 }
 
 /**
- * Performs a left rotation such that if X has a left child named A, and a right child named Y where Y has a 
- * left child named B and a right child named Z; the following will be the result. Y will have a left child of 
- * X and a right child of Z, X will have a left child of A and a right child of B.
+ * Returns an iterator to the first node in key order holding the given key, or the end iterator if the key is
+ * not in the tree. Unlike search, the position is stable among duplicates which makes it a valid starting point
+ * for walking every node sharing the key.
  * 
- * @param rbNode<T>*
- * @return void
+ * @param Key&
+ * @return iterator
  */
-template <class T>
-void RBT<T>::leftRotate(rbNode<T>* x)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator RBTree<Key, Value, Compare, Alloc, Aug>::find(const Key& key)
 {
-    rbNode<T>* y = x->right;
-    x->right = y->left;
-    
-    if (y->left != sentinel)
-        y->left->parent = x;
-
-    y->parent = x->parent;
-
-    if (x->parent == sentinel)
-        this->root = y;
-    else if (x == x->parent->left)
-        x->parent->left = y;
-    else 
-        x->parent->right = y;
+    iterator it = lower_bound(key);
 
-    y->left = x;
-    x->parent = y;
+    if (it != end() && !comp(key, it->key))
+        return it;
+    return end();
 }
 
 /**
- * Private method which prints the inorder traversal of keys regarding the current state of the tree with color.
+ * Returns the number of keys within the closed range [lo, hi] as the difference of two rank descents. Requires
+ * the order statistic augmentation.
  * 
- * @param rbNode<T>*
- * @return void 
+ * @param Key&
+ * @param Key&
+ * @return size_t
  */
-template <class T>
-void RBT<T>::inorder(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::countRange(const Key& lo, const Key& hi)
 {
-    if (root == sentinel)
-        return;
-    
-    inorder(root->left);
-    
-    if (root->rbColor == BLACK)
-            std::cout << "\033[1;30m" << root->key << " \033[0m";
-        else // RED
-            std::cout << "\033[1;31m" << root->key << " \033[0m";
-
-    inorder(root->right);
+    if (comp(hi, lo))
+        return 0;
+    return countBelow(hi, true) - countBelow(lo, false);
 }
 
 /**
- * Private method which prints the preorder traversal of keys regarding the current state of the tree with color.
+ * Public wrapper for searching through the tree structure for some key and will return the appropriate node*
+ * structure. If the structure does not exist, the function will return the sentinel structure.
  * 
- * @param rbNode<T>*
- * @return void 
+ * @param Key&
+ * @return node*
  */
-template <class T>
-void RBT<T>::preorder(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::search(const Key& key)
 {
-    if (root == sentinel)
-        return;
-    
-    if (root->rbColor == BLACK)
-            std::cout << "\033[1;30m" << root->key << " \033[0m";
-        else // RED
-            std::cout << "\033[1;31m" << root->key << " \033[0m";
-    
-    preorder(root->left);
-    
-    preorder(root->right);
+    return psearch(root, key);
 }
 
 /**
- * Performs a right rotation such that if Y has a left child named X, and a right child named Z where X has a 
- * left child named A and a right child named B; the following will be the result. X will have a left child of 
- * A and a right child of Y, Y will have a left child of B and a right child of Z.
- * 
- * @param rbNode<T>*
+ * Public wrapper for inserting a value by creating a node structure which stores the value inline next to the
+ * respective key, the value is moved into the node. Once the structure is created the private interface is called
+ * to link the node into the tree. Keys already present are kept, the new node goes before them.
+ *
+ * @param Key&
+ * @param Value
  * @return void
  */
-template <class T>
-void RBT<T>::rightRotate(rbNode<T>* y)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::insert(const Key& key, Value data)
 {
-    rbNode<T>* x = y->left;
-    y->left = x->right;
+    attach(instantiateNode(key, std::move(data)), root);
+}
 
-    if (x->right != sentinel)
-        x->right->parent = y;
-
-    x->parent = y->parent;
-
-    if (y->parent == sentinel)
-        this->root = x;
-    else if (y == y->parent->left)
-        y->parent->left = x;
-    else 
-        y->parent->right = x;
-
-    x->right = y;
-    y->parent = x;
+/**
+ * Constructs a value in place from args inside a new node holding key and links the node into the tree, so the
+ * value is never copied or moved. Keys already present are kept, like insert. Returns an iterator to the new node.
+ *
+ * @param Key&
+ * @param Args&&...
+ * @return iterator
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class... Args>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::emplace(const Key& key, Args&&... args)
+{
+    node* n = instantiateNode(key, std::forward<Args>(args)...);
+    attach(n, root);
+    return iterator(n, sentinel);
 }
 
 /**
- * Private method which prints the preorder traversal of keys regarding the current state of the tree with color.
- * 
- * @param rbNode<T>*
- * @return void 
+ * Inserts a node holding key and data as close as possible to just before hint, in the manner of the hinted insert
+ * of std::map. When the key belongs right before hint the node is linked next to it without any descent; otherwise
+ * the insertion climbs from hint through the parent pointers only until it reaches a subtree whose key range holds
+ * the key, and descends from there. A hint that is far off therefore costs no more than a plain insert, while a
+ * stream of keys inserted in order before a fixed position costs amortized O(1) per key. Returns an iterator to
+ * the new node.
+ *
+ * @param iterator
+ * @param Key&
+ * @param Value
+ * @return iterator
  */
-template <class T>
-void RBT<T>::postorder(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::insert(iterator hint, const Key& key, Value data)
 {
-    if (root == sentinel)
-        return;
-    
-    postorder(root->left);
-    
-    postorder(root->right);
-
-    if (root->rbColor == BLACK)
-            std::cout << "\033[1;30m" << root->key << " \033[0m";
-        else // RED
-            std::cout << "\033[1;31m" << root->key << " \033[0m";
+    node* n = instantiateNode(key, std::move(data));
+    attach(n, pfinger(hint.get(), key));
+    return iterator(n, sentinel);
 }
 
 /**
- * Private method which traverses the tree from the root in order to find the minimum currently in the tree struct.
- * The minimum is determined by the key value of the rbNode<T> structure and is left up to the use case for what
- * the key value represents.
- *  
- * @param rbNode<T>*
- * @return rbNode<T>*
+ * Inserts a node holding key and data starting from the largest node of the tree, which is cached, equivalent to
+ * insert(end(), key, data). Keys arriving in increasing order, such as timestamps or sequence numbers, are linked
+ * as the right child of the previous maximum in amortized O(1); a key smaller than the maximum climbs the right
+ * spine only as far as needed. Trees with an augmentation policy still refresh the path up to the root.
+ *
+ * @param Key&
+ * @param Value
+ * @return iterator
  */
-template <class T>
-rbNode<T>* RBT<T>::pmin(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::append(const Key& key, Value data)
 {
-    while (root->left != sentinel)
-        root = root->left;
-    return root;
+    node* n = instantiateNode(key, std::move(data));
+    attach(n, pfinger(sentinel, key));
+    return iterator(n, sentinel);
 }
 
 /**
- * Private method which traverses the tree from the root in order to find the maximum currently in the tree struct.
- * The maximum is determined by the key value of the rbNode<T> structure and is left up to the use case for what
- * the key value represents.
+ * Constructs a value in place from args and inserts it under key only if the key is not present yet; otherwise
+ * nothing is constructed and args are left untouched. Returns an iterator to the node holding key and whether the
+ * insertion took place.
+ *
+ * @param Key&
+ * @param Args&&...
+ * @return pair<iterator, bool>
  */
-template <class T>
-rbNode<T>* RBT<T>::pmax(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class... Args>
+std::pair<typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator, bool>
+RBTree<Key, Value, Compare, Alloc, Aug>::try_emplace(const Key& key, Args&&... args)
 {
-    while (root->right != sentinel)
-        root = root->right;
-    return root;
+    node* n = search(key);
+
+    if (n != sentinel)
+        return std::make_pair(iterator(n, sentinel), false);
+    return std::make_pair(emplace(key, std::forward<Args>(args)...), true);
 }
 
 /**
- * Releases resources saved in the RBT in a depth first manner which propagates all the way up to the root.
- * 
- * @param rbNode<T>*
- * @return void
+ * Assigns value to the first node holding key, or inserts a new node holding key and value if the key is not
+ * present. Returns an iterator to the node holding key and whether an insertion took place.
+ *
+ * @param Key&
+ * @param M&&
+ * @return pair<iterator, bool>
  */
-template <class T>
-void RBT<T>::deleteTree(rbNode<T>* root)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class M>
+std::pair<typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator, bool>
+RBTree<Key, Value, Compare, Alloc, Aug>::insert_or_assign(const Key& key, M&& value)
 {
-    if (root->left == sentinel && root->right == sentinel) // leaf node
-    {
-        if (root != sentinel)
-            delete root; 
-    }
-    else if (root->left == sentinel) // left leaf branch
-    {
-        deleteTree(root->right);
-
-        if (root != sentinel)
-            delete root;
-    }
-    else if (root->right == sentinel) // right leaf branch
-    {
-        deleteTree(root->left);
+    iterator it = find(key);
 
-        if (root != sentinel)
-            delete root;
-    }
-    else // internal node with active branches
+    if (it != end())
     {
-        deleteTree(root->left);
-        deleteTree(root->right);
-
-        if (root != sentinel)
-            delete root;
+        it->data = std::forward<M>(value);
+        return std::make_pair(it, false);
     }
+    return std::make_pair(emplace(key, std::forward<M>(value)), true);
 }
 
 /**
- * In order to move subtrees around the red-black tree we define a routine
- * which replaces one subtree as a child of its parent with another subtree.
- * When replacing the subtree rooted at node u with the subtree rooted at node v,
- * node u's parent becomes node v's parent and u's parent ends up having v as its
- * appropriate child.
+ * Returns an iterator to the first node whose key is not less than the given key, or the end iterator if there
+ * is no such node. The descent is iterative and remembers the last node where it turned left.
  * 
- * @param rbNode<T>*
- * @param rbNode<T>*
+ * @param Key&
+ * @return iterator
  */
-template <class T>
-void RBT<T>::rbTransplant(rbNode<T>* u, rbNode<T>* v)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::lower_bound(const Key& key)
 {
-    if (u->parent == sentinel) // if u is root
-        root = v; 
-    else if (u == u->parent->left) // if u is left child
-        u->parent->left = v;
-    else
-        u->parent->right = v; // if u is right child
-    
-    // "Exploit" ability to assign v.p when v == T.nil
-    v->parent = u->parent;
+    node* n = root;
+    node* candidate = sentinel;
+
+    while (n != sentinel)
+    {
+        if (!comp(n->key, key))
+        {
+            candidate = n;
+            n = n->left;
+        }
+        else
+            n = n->right;
+    }
+
+    return iterator(candidate, sentinel);
 }
 
 /**
- * When called 3 problems may have arose from the red black tree pdel. First, if y had been
- * the root and a red child of y becomes the new root, we have violated the root must be black
- * property. Secondly, if both x and x.p are red, then we have violated that if a node is red,
- * then both its children are black property. Thirdly, moving y within the tree causes any simple
- * path that previously contained y to have one fewer black nodes, thus the "for each node, all
- * simple paths from the node to decendant leaves contain the same number of black nodes" property
- * is now violated by any ancester of y in the tree.
+ * Returns an iterator to the first node whose key is greater than the given key, or the end iterator if there
+ * is no such node.
  * 
- * @param rbNode<T>* &
- * @param rbNode<T>* &
- * @return void
+ * @param Key&
+ * @return iterator
  */
-template <class T>
-void RBT<T>::pdelFixup(rbNode<T>* &root, rbNode<T>* &ptr)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::upper_bound(const Key& key)
 {
-    /* Goal: Continue to move the 'extra black' up the tree until:
-     *      1. ptr points to a red-and-black node, which we color ptr (singly) black at end.
-     *      2. ptr points to the root, in which case we simply "remove" the extra black, or
-     *      3. Having performed suitable rotations and recolorings, we exit.
-     */
-    while ((ptr != root) && (ptr->rbColor == BLACK))
-    {
-        // While in the loop, ptr always points to a nonroot, doubly black node.
+    node* n = root;
+    node* candidate = sentinel;
 
-        /* Case A:
-         * If ptr is a left child of parent x.p
-         */
-        if (ptr == ptr->parent->left)
+    while (n != sentinel)
+    {
+        if (comp(key, n->key))
         {
-            // sibling of ptr
-            rbNode<T>* w = ptr->parent->right;
+            candidate = n;
+            n = n->left;
+        }
+        else
+            n = n->right;
+    }
 
-            /* Case 1A:
-             * Sibling is red
-             * 
-             * Since w must have black children, we can switch the colors of w and ptr->parent
-             * then perform a left-rotation on ptr->parent without violating any of the red-black
-             * properties. The new sibling of x, which is one of w's children prior to the rotation,
-             * is now black.
-             */
-            if (w->rbColor == RED)
-            {
-                w->rbColor = BLACK;
-                ptr->parent->rbColor = RED;
-                leftRotate(ptr->parent);
-                w = ptr->parent->right;
-            }
+    return iterator(candidate, sentinel);
+}
 
-            /* Case 2A:
-             * Sibling w is black and both of w's children are black
-             * 
-             * Since w and its children are black, we take one black off both ptr and w, leaving
-             * ptr with only one black and leaving w red. To compensate for removing one black from
-             * ptr and w, we would like to add an extra black to ptr->parent, which was originally
-             * red or black. We do so by repeating the while loop with ptr->parent as the new ptr.
-             */
-            if (w->left->rbColor == BLACK && w->right->rbColor == BLACK)
-            {
-                w->rbColor = RED;
-                ptr = ptr->parent;
-            }
+/**
+ * Inserts an unsorted batch of (key, data) pairs. The batch is sorted first; when it is small compared to the
+ * tree the pairs are inserted one at a time in key order, which keeps consecutive descents on the same warm path.
+ * Otherwise the batch is merged with the in order sequence of the existing nodes and the whole tree is relinked
+ * bottom-up in linear time, which costs O(n + m log m) rather than O(m log (n + m)). Existing nodes are relinked
+ * rather than reallocated, so pointers to them stay valid. Equal keys from the batch are placed before those
+ * already in the tree, matching insert.
+ * 
+ * @param It
+ * @param It
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class It>
+void RBTree<Key, Value, Compare, Alloc, Aug>::insertBatch(It first, It last)
+{
+    std::vector<std::pair<Key, Value>> batch(first, last);
 
-            /* Case 3A:
-             * Ptr's sibling w is black, w's left child is red, and w's right child is black
-             * 
-             * We can switch out the colors of w and its left child w->left and the perform a 
-             * right rotation on w without violating any red-black properties. The new sibling
-             * w of x is now a black node with a red right child.
-             */
-            else if (w->right->rbColor == BLACK)
-            {
-                w->left->rbColor = BLACK;
-                w->rbColor = RED;
-                rightRotate(w);
-                w = ptr->parent->right;
-            }
+    std::stable_sort(batch.begin(), batch.end(), 
+        [this](const std::pair<Key, Value>& a, const std::pair<Key, Value>& b) {
+            return comp(a.first, b.first);
+        });
 
-            /* Case 4A:
-             * Ptr's sibling w is black, and w's right child is red
-             * 
-             * By making some color changes and performing a left rotation on ptr->parent, we
-             * can remove the extra black on ptr, making it singly black, without violating
-             * any of the red-black properties. Setting ptr to be root causes the while loop
-             * to terminate.
-             */
-            else
-            {
-                w->rbColor = ptr->parent->rbColor;
-                ptr->parent->rbColor = BLACK;
-                w->right->rbColor = BLACK;
-                leftRotate(ptr->parent);
-                ptr = root;
-            }
-        }
-        /* Case B:
-         * If ptr is a right child of parent x.p
-         */ 
-        else
-        {
-            // sibling of ptr
-            rbNode<T>* w = ptr->parent->left;
+    std::size_t height = 0;
+    for (std::size_t n = nodeCount; n > 0; n >>= 1)
+        height++;
 
-            /* Case 1B:
-             * Sibling is red
-             * 
-             * Since w must have black children, we can switch the colors of w and ptr->parent
-             * then perform a right-rotation on ptr->parent without violating any of the red-black
-             * properties. The new sibling of x, which is one of w's children prior to the rotation,
-             * is now black.
-             */
-            if (w->rbColor == RED)
-            {
-                w->rbColor = BLACK;
-                ptr->parent->rbColor = RED;
-                rightRotate(ptr->parent);
-                w = ptr->parent->left;
-            }
+    // m descents of about log n steps each beat touching all n + m nodes
+    if (batch.size() * height < nodeCount)
+    {
+        for (std::size_t i = 0; i < batch.size(); i++)
+            insert(batch[i].first, std::move(batch[i].second));
+        return;
+    }
 
-            /* Case 2B:
-             * Sibling w is black and both of w's children are black
-             * 
-             * Since w and its children are black, we take one black off both ptr and w, leaving
-             * ptr with only one black and leaving w red. To compensate for removing one black from
-             * ptr and w, we would like to add an extra black to ptr->parent, which was originally
-             * red or black. We do so by repeating the while loop with ptr->parent as the new ptr.
-             */
-            if (w->right->rbColor == BLACK && w->left->rbColor == BLACK)
-            {
-                w->rbColor = RED;
-                ptr = ptr->parent;
-            }
+    std::vector<node*> order;
+    order.reserve(nodeCount + batch.size());
+    nodes.reserve(batch.size());
 
-            /* Case 3B:
-             * Ptr's sibling w is black, w's right child is red, and w's left child is black
-             * 
-             * We can switch out the colors of w and its right child w->right and the perform a 
-             * left rotation on w without violating any red-black properties. The new sibling
-             * w of x is now a black node with a red left child.
-             */
-            else if (w->left->rbColor == BLACK)
-            {
-                w->right->rbColor = BLACK;
-                w->rbColor = RED;
-                leftRotate(w);
-                w = ptr->parent->left;
-            }
+    iterator it = begin();
+    iterator stop = end();
 
-            /* Case 4B:
-             * Ptr's sibling w is black, and w's left child is red
-             * 
-             * By making some color changes and performing a right rotation on ptr->parent, we
-             * can remove the extra black on ptr, making it singly black, without violating
-             * any of the red-black properties. Setting ptr to be root causes the while loop
-             * to terminate.
-             */
-            else
-            {
-                w->rbColor = ptr->parent->rbColor;
-                ptr->parent->rbColor = BLACK;
-                w->left->rbColor = BLACK;
-                rightRotate(ptr->parent);
-                ptr = root;
-            }
-        }
+    for (std::size_t i = 0; i < batch.size(); i++)
+    {
+        for (; it != stop && comp(it->key, batch[i].first); ++it)
+            order.push_back(it.get());
+        order.push_back(instantiateNode(batch[i].first, std::move(batch[i].second)));
     }
-    ptr->rbColor = BLACK;
+    for (; it != stop; ++it)
+        order.push_back(it.get());
+
+    relink(order);
 }
 
 /**
- * A simple recursive binary tree insertion call that is used within the private interface for just adding a new
- * node into the tree structure by traversing down the appropriate subtrees until the sentinel is reached.
- *  
- * @param rbNode<T>*
- * @param rbNode<T>*
- * @return rbNode<T>*
+ * Replaces the contents of the tree with a range of (key, data) pairs which must already be sorted by key. Rather
+ * than n descents and fixups the nodes are allocated in key order and linked into a balanced tree bottom-up in
+ * O(n), see pbuild for how the colors are chosen.
+ * 
+ * @param It
+ * @param It
+ * @return void
  */
-template <class T>
-rbNode<T>* RBT<T>::pinsert(rbNode<T>* root, rbNode<T>* ptr)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class It>
+void RBTree<Key, Value, Compare, Alloc, Aug>::buildFromSorted(It first, It last)
 {
-    if (root == sentinel)
-        return ptr;
+    clear();
 
-    if (ptr->key > root->key)
-    {
-        root->right = pinsert(root->right, ptr);
-        root->right->parent = root;
-    }
-    else
+    std::vector<node*> order;
+    std::size_t n = std::distance(first, last);
+
+    order.reserve(n);
+    nodes.reserve(n);
+
+    // moves the values out when the range yields rvalues, for instance through std::make_move_iterator
+    for (; first != last; ++first)
     {
-        root->left = pinsert(root->left, ptr);
-        root->left->parent = root;
+        typedef typename std::iterator_traits<It>::reference reference;
+        reference pair = *first;
+        order.push_back(instantiateNode(pair.first, std::forward<reference>(pair).second));
     }
-    return root;
+
+    relink(order);
 }
 
 /**
- * Maintains the red-black tree properties by continually recoloring and rotating the tree from bottom to top
- * until the while loop condition is no longer statisfied.
+ * Calls fn with every node whose key lies in the half open range [lo, hi), in key order. The first node is found
+ * with a single descent and the rest by successor steps, so the scan costs O(log n + k) for k visited nodes.
  * 
- * @param rbNode<T>* &
- * @param rbNode<T> *&
+ * @param Key&
+ * @param Key&
+ * @param F
  * @return void
  */
-template <class T>
-void RBT<T>::pinsertFixup(rbNode<T>* &root, rbNode<T>* &ptr)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+void RBTree<Key, Value, Compare, Alloc, Aug>::forEachInRange(const Key& lo, const Key& hi, F fn)
 {
-    rbNode<T>* parent_ptr = sentinel;
-    rbNode<T>* grandparent_ptr = sentinel;
+    iterator last = end();
 
-    // While current ptr is not the root and ptr is red and its parent is also red (adjacent red nodes)
-    while ((ptr != root) && (ptr->rbColor != BLACK) && (ptr->parent->rbColor == RED))
-    {
+    for (iterator it = lower_bound(lo); it != last && comp(it->key, hi); ++it)
+        fn(it.get());
+}
+
+/**
+ * Inserts a node holding the closed interval [start, end] and data, keyed by start, and returns an iterator to it.
+ * The end point is stored before the node is linked, so the largest end points along its path are refreshed with
+ * it. Requires the interval augmentation.
+ * 
+ * @param Key&
+ * @param Key&
+ * @param Value
+ * @return iterator
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::iterator
+RBTree<Key, Value, Compare, Alloc, Aug>::insertInterval(const Key& start, const Key& end, Value data)
+{
+    static_assert(std::is_base_of<typename rbInterval<Key>::fields, node>::value,
+        "insertInterval requires the rbInterval augmentation");
+
+    node* n = instantiateNode(start, std::move(data));
+    n->end = end;
+    n->maxEnd = end;
+    attach(n, root);
+    return iterator(n, sentinel);
+}
+
+/**
+ * Calls fn with every node whose interval [key, end] overlaps the closed range [lo, hi], in key order. Subtrees
+ * whose largest end point lies before lo are skipped, and so is everything right of a node starting after hi. A
+ * query reporting k intervals visits O(log n) nodes for each of them, and only O(log n) when nothing overlaps.
+ * Requires the interval augmentation and a Compare which agrees with operator<, see rbInterval.
+ * 
+ * @param Key&
+ * @param Key&
+ * @param F
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+void RBTree<Key, Value, Compare, Alloc, Aug>::findOverlapping(const Key& lo, const Key& hi, F fn)
+{
+    static_assert(std::is_base_of<typename rbInterval<Key>::fields, node>::value,
+        "findOverlapping and stab require the rbInterval augmentation");
+
+    poverlap(root, lo, hi, fn);
+}
+
+/**
+ * Calls fn with every node whose interval [key, end] contains point, in key order, see findOverlapping.
+ * 
+ * @param Key&
+ * @param F
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+void RBTree<Key, Value, Compare, Alloc, Aug>::stab(const Key& point, F fn)
+{
+    findOverlapping(point, point, fn);
+}
+
+/**
+ * Writes a binary image of the tree to path (see rbimage.h), which load can turn back into a tree in linear time.
+ * Keys and values are copied byte for byte, so both have to be trivially copyable; pointer values would not
+ * survive a restart and need the serializing overload instead. The image is written to a temporary file which
+ * replaces path once it is complete. Returns false if the file could not be written.
+ * 
+ * @param std::string&
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::save(const std::string& path)
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "images require trivially copyable keys");
+    static_assert(std::is_trivially_copyable<Value>::value && !std::is_pointer<Value>::value,
+        "values which are pointers or not trivially copyable have to be saved with a serializer");
+
+    rbImageWriter out(path);
+    std::vector<node*> order = pwriteKeys(out);
+
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        __builtin_prefetch(order[std::min(i + 8, order.size() - 1)]);
+        out.write(&order[i]->data, sizeof(Value));
+    }
+
+    return out.finish(0, sizeof(Key), sizeof(Value), nodeCount);
+}
+
+/**
+ * Writes a binary image of the tree to path whose values are produced by serialize, called as
+ * serialize(const Value&, std::string&) to append the bytes of one value. Each value is stored with its length so
+ * the payloads can have any size. Keys have to be trivially copyable. Returns false if the file could not be
+ * written.
+ * 
+ * @param std::string&
+ * @param S
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class S>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::save(const std::string& path, S serialize)
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "images require trivially copyable keys");
+
+    rbImageWriter out(path);
+    std::vector<node*> order = pwriteKeys(out);
+    std::string bytes;
+
+    for (std::size_t i = 0; i < order.size(); i++)
+    {
+        __builtin_prefetch(order[std::min(i + 8, order.size() - 1)]);
+        bytes.clear();
+        serialize(order[i]->data, bytes);
+
+        std::uint64_t length = bytes.size();
+        out.write(&length, sizeof(length));
+        out.write(bytes.data(), bytes.size());
+    }
+
+    return out.finish(RB_IMAGE_SERIALIZED, sizeof(Key), 0, nodeCount);
+}
+
+/**
+ * Replaces the contents of the tree with an image written by save(path). The file is mapped rather than read, its
+ * checksum verified, and the tree linked bottom-up from the sorted keys in O(n) like buildFromSorted, so loading
+ * runs at about the speed the file can be read. Returns false, leaving the tree as it was, if the file is missing,
+ * corrupt or was written for other key or value types.
+ * 
+ * @param std::string&
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::load(const std::string& path)
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "images require trivially copyable keys");
+    static_assert(std::is_trivially_copyable<Value>::value && !std::is_pointer<Value>::value,
+        "values which are pointers or not trivially copyable have to be loaded with a deserializer");
+
+    rbMappedImage image(path);
+    const rbImageHeader* header = image.validate(0, sizeof(Key), sizeof(Value));
+
+    if (header == nullptr || header->count > header->bodySize / (sizeof(Key) + sizeof(Value)))
+        return false;
+
+    const char* value = image.body() + header->count * sizeof(Key);
+
+    return prestore(image.body(), header->count, [&value](Value& out) {
+        std::memcpy(&out, value, sizeof(Value));
+        value += sizeof(Value);
+        return true;
+    });
+}
+
+/**
+ * Replaces the contents of the tree with an image written by save(path, serialize). Every value is rebuilt by
+ * deserialize, called as deserialize(const char* bytes, std::size_t length) and returning the Value. Returns false,
+ * leaving the tree as it was, if the file is missing, corrupt or was written for another key type.
+ * 
+ * @param std::string&
+ * @param D
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class D>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::load(const std::string& path, D deserialize)
+{
+    static_assert(std::is_trivially_copyable<Key>::value, "images require trivially copyable keys");
+
+    rbMappedImage image(path);
+    const rbImageHeader* header = image.validate(RB_IMAGE_SERIALIZED, sizeof(Key), 0);
+
+    if (header == nullptr)
+        return false;
+
+    const char* record = image.body() + header->count * sizeof(Key);
+    const char* last = image.body() + header->bodySize;
+
+    return prestore(image.body(), header->count, [&](Value& out) {
+        std::uint64_t length;
+
+        if (last - record < (std::ptrdiff_t) sizeof(length))
+            return false;
+
+        std::memcpy(&length, record, sizeof(length));
+        record += sizeof(length);
+
+        if (length > (std::uint64_t) (last - record))
+            return false;
+
+        out = deserialize(record, (std::size_t) length);
+        record += length;
+        return true;
+    });
+}
+
+/**
+ * Returns the operation counters collected since construction or the last resetStats, all zero unless RBT_STATS
+ * was defined, together with the current shape of the tree: node count, height (the number of nodes on the
+ * longest path from the root), black height and the average depth of a node, the root having depth 1. The shape is
+ * measured by a walk over the whole tree, so this costs O(n).
+ * 
+ * @return rbStats
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+rbStats RBTree<Key, Value, Compare, Alloc, Aug>::stats()
+{
+    rbStats s = rbStats();
+#ifdef RBT_STATS
+    counters.copyTo(s);
+#endif
+
+    double depthSum = 0;
+
+    s.nodeCount = nodeCount;
+    s.height = 0;
+    s.blackHeight = blackHeight(root, sentinel);
+    pshape(root, 1, s.height, depthSum);
+    s.averageDepth = nodeCount ? depthSum / nodeCount : 0;
+
+    return s;
+}
+
+/**
+ * Sets every operation counter back to zero, a no-op unless RBT_STATS was defined.
+ * 
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::resetStats()
+{
+#ifdef RBT_STATS
+    counters.reset();
+#endif
+}
+
+/**
+ * Looks up n keys at once and stores for each the node search would have returned, the sentinel for keys which
+ * are not present, in out. The lookups advance together so that the cache misses of different keys overlap instead
+ * of being paid one after another, see pbatch. Worthwhile once the tree no longer fits in the cache.
+ * 
+ * @param Key*
+ * @param size_t
+ * @param node**
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::searchBatch(const Key* keys, std::size_t n, node** out)
+{
+    pbatch(keys, n, [out](std::size_t i, node* found) { out[i] = found; });
+}
+
+/**
+ * Looks up n keys at once like searchBatch and stores in out whether each key is present.
+ * 
+ * @param Key*
+ * @param size_t
+ * @param bool*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::containsBatch(const Key* keys, std::size_t n, bool* out)
+{
+    node* leaf = sentinel;
+    pbatch(keys, n, [out, leaf](std::size_t i, node* found) { out[i] = found != leaf; });
+}
+
+/**
+ * Exports the tree into a FrozenRBT, a read only copy laid out for fast lookups (see frozenrbt.h). Keys and values
+ * are copied in key order in O(n), so Value has to be copy constructible; the tree itself is left unchanged and
+ * later modifications of it are not reflected in the frozen copy.
+ * 
+ * @return FrozenRBT<Key, Value, Compare>
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+FrozenRBT<Key, Value, Compare> RBTree<Key, Value, Compare, Alloc, Aug>::freeze()
+{
+    std::vector<Key> keys;
+    std::vector<Value> values;
+
+    keys.reserve(nodeCount);
+    values.reserve(nodeCount);
+
+    for (iterator it = begin(), last = end(); it != last; ++it)
+    {
+        keys.push_back(it->key);
+        values.push_back(it->data);
+    }
+
+    return FrozenRBT<Key, Value, Compare>(std::move(keys), std::move(values), comp);
+}
+
+/**
+ * Appends every element of right to this tree, right is left empty. All keys of right are expected to be no
+ * smaller than every key of this tree; in that case the two trees are concatenated with a single join in
+ * O(log n) plus a pass over the moved nodes to point their leaves at this tree's sentinel. If the key ranges
+ * overlap the trees are merged with unionWith instead.
+ * 
+ * @param RBTree&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::join(RBTree& right)
+{
+    if (&right == this || right.root == right.sentinel)
+        return;
+
+    if (root != sentinel && comp(right.pmin(right.root)->key, pmax(root)->key))
+    {
+        unionWith(right);
+        return;
+    }
+
+    node* r = right.root;
+    std::size_t moved = pretarget(r, right.sentinel, right.nodeCount >= (std::size_t(1) << PARALLEL_GRAIN) ? 
+        forkDepth() : 0);
+    r->parent = sentinel;
+
+    nodes.adopt(right.nodes);
+    right.root = right.sentinel;
+    right.nodeCount = 0;
+    right.refreshEnds();
+    right.sentinel->left = right.root;
+    right.sentinel->right = right.root;
+    right.sentinel->parent = right.root;
+
+    root = pjoin2(root, r);
+    nodeCount += moved;
+    refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Moves every element of other into this tree, other is left empty. The elements of both trees are kept, so keys
+ * present in both end up duplicated just as if each element of other had been inserted. The merge is the join
+ * based union: other is exposed at its root, this tree is split around that key and the two halves are merged
+ * recursively before being joined back together around the root of other. The two recursive calls touch
+ * disjoint subtrees so, above the PARALLEL_GRAIN size, one of them is handed to another thread. No node is
+ * allocated or freed while merging, the nodes of other are relinked and its pool is adopted. Merging a tree with
+ * itself does nothing.
+ * 
+ * @param RBTree&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::unionWith(RBTree& other)
+{
+    if (&other == this || other.root == other.sentinel)
+        return;
+
+    int depth = forkDepth();
+    node* b = other.root;
+    std::size_t moved = pretarget(b, other.sentinel, other.nodeCount >= (std::size_t(1) << PARALLEL_GRAIN) ? 
+        depth : 0);
+    b->parent = sentinel;
+
+    nodes.adopt(other.nodes);
+    other.root = other.sentinel;
+    other.nodeCount = 0;
+    other.refreshEnds();
+    other.sentinel->left = other.root;
+    other.sentinel->right = other.root;
+    other.sentinel->parent = other.root;
+
+    root = punion(root, b, depth);
+    nodeCount += moved;
+    refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Keeps only the elements whose key is also present in other, other is not modified. Like unionWith the tree is
+ * split around the root key of other and both halves are intersected in parallel above the grain size. Nodes
+ * which are dropped are collected while the recursion runs and only handed back to the allocator once every
+ * thread has finished.
+ * 
+ * @param RBTree&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::intersectWith(RBTree& other)
+{
+    if (&other == this)
+        return;
+
+    std::vector<node*> garbage;
+    root = pintersect(root, other.root, other.sentinel, forkDepth(), garbage);
+
+    for (std::size_t i = 0; i < garbage.size(); i++)
+        nodeCount -= deleteTree(garbage[i]);
+    refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Removes every element whose key is present in other, other is not modified. Works the same way as intersectWith
+ * but keeps the parts of the tree falling between the keys of other instead.
+ * 
+ * @param RBTree&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::differenceWith(RBTree& other)
+{
+    if (&other == this)
+    {
+        clear();
+        return;
+    }
+
+    std::vector<node*> garbage;
+    root = pdifference(root, other.root, other.sentinel, forkDepth(), garbage);
+
+    for (std::size_t i = 0; i < garbage.size(); i++)
+        nodeCount -= deleteTree(garbage[i]);
+    refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Sets the number of threads the set operations may spread their work over, defaults to the number of hardware
+ * threads. A value of 0 or 1 keeps every operation on the calling thread.
+ * 
+ * @param unsigned
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::setParallelism(unsigned threads)
+{
+    parallelism = threads;
+}
+
+/**
+ * Moves every element whose key is greater than or equal to key into right, replacing whatever right held. The
+ * tree is split along a single root to leaf path with O(log n) joins, after which the moved nodes have their
+ * leaves pointed at the sentinel of right. Right shares the slabs of this tree's pool so the moved nodes stay
+ * valid for as long as either tree needs them.
+ * 
+ * @param Key&
+ * @param RBTree&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::split(const Key& key, RBTree& right)
+{
+    if (&right == this)
+        return;
+
+    right.clear();
+
+    node* l;
+    node* r;
+    psplit(root, key, false, l, r);
+    root = l;
+
+    right.nodes.share(nodes);
+
+    if (r != sentinel)
+    {
+        std::size_t moved = right.pretarget(r, sentinel, nodeCount >= (std::size_t(1) << PARALLEL_GRAIN) ?
+            forkDepth() : 0);
+        r->parent = right.sentinel;
+        right.root = r;
+        right.nodeCount = moved;
+        nodeCount -= moved;
+    }
+
+    refreshEnds();
+    right.refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+
+    right.sentinel->left = right.root;
+    right.sentinel->right = right.root;
+    right.sentinel->parent = right.root;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              PRIVATE INTERFACE                                          ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * The red black tree deletion procedure is an extension to the basic binary tree 
+ * deletion with the following additions. We maintain node y as the node either removed
+ * from the tree or moved within the tree. We need to save y's original color in both cases
+ * in order to test it at the end where if it was black, then removing or moving y could cause
+ * violations of the red-black properties. We also track node x that moves into node y's original
+ * position. We also always set x.p to point to the original position in the tree of y's parent even 
+ * if x is, in fact, the sentinel. Finally, if node y was black, we might have introduced violations
+ * of red-black properties so we call pdelFixup to restore red-black properties.
+ * 
+ * @param node*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pdel(node* z)
+{
+    node* x;
+    node* y = z;
+    rbColor yOrig = (rbColor) y->rbColor;
+
+    if (z->left == sentinel) // no children or only right
+    {
+        // x contains right subtree which needs to be transplanted to move out z
+        x = z->right;
+        rbTransplant(z, z->right);
+    }
+    else if (z->right == sentinel) // only left child
+    {
+        // x contains left subtree which needs to be transplanted to move out z
+        x = z->left;
+        rbTransplant(z, z->left);
+    }
+    else // both children
+    {
+        // Get z's successor which will move into z's position in the tree
+        y = pmin(z->right);
+        yOrig = (rbColor) y->rbColor;
+        x = y->right;
+        
+        /* When y's original parent is z, we do not want x's parent to point to the node
+         * being removed from the tree. Because node y will move up to take z's position in
+         * the tree, setting x's parent to y causes x.p to point to the original position of 
+         * y's parent, even if x == sentinel.
+         */
+        if (y->parent == z)
+            x->parent = y;
+        else
+        {
+            /*
+             * Otherwise, notice that x's parent is always set via the rbTransplant function.
+             */
+            rbTransplant(y, y->right);
+
+            // reconfigure y's right pointers based on z
+            y->right = z->right;
+            y->right->parent = y;
+        }
+        // transplant z with y
+        rbTransplant(z, y);
+
+        // reconfigure y's left pointers and color based on z
+        y->left = z->left;
+        y->left->parent = y;
+        y->rbColor = z->rbColor;
+    }
+
+    /* 
+     * If the original color of y was black, we might have introduced one or more violations
+     * of the red-black properties. If y was red, the red-black properties still hold when
+     * y is removed or moved for the following reasons:
+     *  1. No black-heights in the tree have changed
+     *  2. No red nodes have been made adjacent. Because y takes z's place in the tree, along
+     *  with z's color, we cannot have two adjacent red nodes at y's new position in the tree.
+     *      - In addition, if y was not z's right child, then y's original right child x replaces
+     *      y in the tree. If y is red, then x must be black, and so replacing y by x cannot 
+     *      cause two red nodes to become adjacent.
+     *  3. Since y could not have been the root if it was red, the root remains black.
+     */
+    // x.p is the lowest node whose subtree changed, refresh augmented fields from there up
+    augmentPath(x->parent);
+
+    if (yOrig == BLACK)
+        pdelFixup(this->root, x);
+    
+    destroyNode(z);
+}
+
+/**
+ * Performs a left rotation such that if X has a left child named A, and a right child named Y where Y has a 
+ * left child named B and a right child named Z; the following will be the result. Y will have a left child of 
+ * X and a right child of Z, X will have a left child of A and a right child of B. The top reference is the root
+ * of the (sub)tree being rotated in and is moved onto Y when X had no parent.
+ * 
+ * @param node*
+ * @param node* &
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::leftRotate(node* x, node* &top)
+{
+    RB_COUNT(leftRotations);
+
+    node* y = x->right;
+    x->right = y->left;
+    
+    if (y->left != sentinel)
+        y->left->parent = x;
+
+    y->parent = x->parent;
+
+    if (x->parent == sentinel)
+        top = y;
+    else if (x == x->parent->left)
+        x->parent->left = y;
+    else 
+        x->parent->right = y;
+
+    y->left = x;
+    x->parent = y;
+
+    // x is now the child of y so its fields must be rebuilt first
+    Aug::update(x);
+    Aug::update(y);
+}
+
+/**
+ * Private method which prints the inorder traversal of keys regarding the current state of the tree with color.
+ * 
+ * @param node*
+ * @return void 
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::inorder(node* root)
+{
+    if (root == sentinel)
+        return;
+    
+    inorder(root->left);
+    
+    if (root->rbColor == BLACK)
+            std::cout << "\033[1;30m" << root->key << " \033[0m";
+        else // RED
+            std::cout << "\033[1;31m" << root->key << " \033[0m";
+
+    inorder(root->right);
+}
+
+/**
+ * Private method which prints the preorder traversal of keys regarding the current state of the tree with color.
+ * 
+ * @param node*
+ * @return void 
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::preorder(node* root)
+{
+    if (root == sentinel)
+        return;
+    
+    if (root->rbColor == BLACK)
+            std::cout << "\033[1;30m" << root->key << " \033[0m";
+        else // RED
+            std::cout << "\033[1;31m" << root->key << " \033[0m";
+    
+    preorder(root->left);
+    
+    preorder(root->right);
+}
+
+/**
+ * Performs a right rotation such that if Y has a left child named X, and a right child named Z where X has a 
+ * left child named A and a right child named B; the following will be the result. X will have a left child of 
+ * A and a right child of Y, Y will have a left child of B and a right child of Z. The top reference is the root
+ * of the (sub)tree being rotated in and is moved onto X when Y had no parent.
+ * 
+ * @param node*
+ * @param node* &
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::rightRotate(node* y, node* &top)
+{
+    RB_COUNT(rightRotations);
+
+    node* x = y->left;
+    y->left = x->right;
+
+    if (x->right != sentinel)
+        x->right->parent = y;
+
+    x->parent = y->parent;
+
+    if (y->parent == sentinel)
+        top = x;
+    else if (y == y->parent->left)
+        y->parent->left = x;
+    else 
+        y->parent->right = x;
+
+    x->right = y;
+    y->parent = x;
+
+    // y is now the child of x so its fields must be rebuilt first
+    Aug::update(y);
+    Aug::update(x);
+}
+
+/**
+ * Private method which prints the preorder traversal of keys regarding the current state of the tree with color.
+ * 
+ * @param node*
+ * @return void 
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::postorder(node* root)
+{
+    if (root == sentinel)
+        return;
+    
+    postorder(root->left);
+    
+    postorder(root->right);
+
+    if (root->rbColor == BLACK)
+            std::cout << "\033[1;30m" << root->key << " \033[0m";
+        else // RED
+            std::cout << "\033[1;31m" << root->key << " \033[0m";
+}
+
+/**
+ * Private method which traverses the tree from the root in order to find the minimum currently in the tree struct.
+ * The minimum is determined by the key value of the node structure and is left up to the use case for what
+ * the key value represents.
+ *  
+ * @param node*
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::pmin(node* root)
+{
+    while (root->left != sentinel)
+        root = root->left;
+    return root;
+}
+
+/**
+ * Private method which traverses the tree from the root in order to find the maximum currently in the tree struct.
+ * The maximum is determined by the key value of the node structure and is left up to the use case for what
+ * the key value represents.
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node* RBTree<Key, Value, Compare, Alloc, Aug>::pmax(node* root)
+{
+    while (root->right != sentinel)
+        root = root->right;
+    return root;
+}
+
+/**
+ * Releases resources saved in the RBT in a depth first manner which propagates all the way up to the root and
+ * returns the number of nodes released.
+ * 
+ * @param node*
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::deleteTree(node* root)
+{
+    std::size_t count = 0;
+
+    if (root->left == sentinel && root->right == sentinel) // leaf node
+    {
+        if (root != sentinel)
+            count++;
+    }
+    else if (root->left == sentinel) // left leaf branch
+    {
+        count += deleteTree(root->right) + 1;
+    }
+    else if (root->right == sentinel) // right leaf branch
+    {
+        count += deleteTree(root->left) + 1;
+    }
+    else // internal node with active branches
+    {
+        // the right subtree is fetched while the left one is released
+        __builtin_prefetch(root->right);
+        count += deleteTree(root->left);
+        count += deleteTree(root->right) + 1;
+    }
+
+    if (root != sentinel)
+        destroyNode(root);
+
+    return count;
+}
+
+/**
+ * Recomputes the augmented fields of n and every ancestor of n up to the root. Nothing is walked when the tree is
+ * not augmented.
+ * 
+ * @param node*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::augmentPath(node* n)
+{
+    if (!Aug::augmented)
+        return;
+
+    while (n != sentinel)
+    {
+        Aug::update(n);
+        n = n->parent;
+    }
+}
+
+/**
+ * Discards the current shape of the tree and links the given nodes, which must be in key order, into a balanced
+ * red black tree. The sentinel is reset onto the new root afterwards.
+ * 
+ * @param vector<node*>&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::relink(std::vector<node*>& order)
+{
+    std::size_t n = order.size();
+    std::size_t fullDepth = 0;
+
+    // number of levels which are completely filled, the largest d such that 2^d - 1 <= n
+    while ((std::size_t(2) << fullDepth) - 1 <= n)
+        fullDepth++;
+
+    root = pbuild(order.data(), n, 0, fullDepth, sentinel);
+    nodeCount = n;
+    refreshEnds();
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Reports the intervals below n overlapping [lo, hi]. The left subtree is searched recursively while the walk to
+ * the right is a loop, so the recursion only ever goes as deep as the tree.
+ * 
+ * @param node*
+ * @param Key&
+ * @param Key&
+ * @param F&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+void RBTree<Key, Value, Compare, Alloc, Aug>::poverlap(node* n, const Key& lo, const Key& hi, F& fn)
+{
+    while (n != sentinel && !comp(n->maxEnd, lo))
+    {
+        poverlap(n->left, lo, hi, fn);
+
+        // n and everything right of it start after hi
+        if (comp(hi, n->key))
+            return;
+
+        if (!comp(n->end, lo))
+            fn(n);
+
+        n = n->right;
+    }
+}
+
+/**
+ * Appends the nodes below n in key order to drop when pred holds for them and to keep otherwise. The walk recurses
+ * instead of stepping an iterator, which would climb back through the parents, and prefetches the right child
+ * before descending left, so the next subtree is usually in cache by the time the left one is done. On trees built
+ * in random order this visits the nodes several times faster than iterating.
+ * 
+ * @param node*
+ * @param P&
+ * @param vector<node*>&
+ * @param vector<node*>&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class P>
+void RBTree<Key, Value, Compare, Alloc, Aug>::ppartition(node* n, P& pred, std::vector<node*>& keep,
+    std::vector<node*>& drop)
+{
+    while (n != sentinel)
+    {
+        __builtin_prefetch(n->right);
+        ppartition(n->left, pred, keep, drop);
+
+        if (pred(n))
+            drop.push_back(n);
+        else
+            keep.push_back(n);
+
+        n = n->right;
+    }
+}
+
+/**
+ * Recomputes the cached smallest and largest nodes after an operation which changed the tree other than through
+ * attach and erase.
+ * 
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::refreshEnds()
+{
+    leftmost = root == sentinel ? sentinel : pmin(root);
+    rightmost = root == sentinel ? sentinel : pmax(root);
+}
+
+/**
+ * Writes every key to out in key order and returns the nodes in the same order, so that the values can be written
+ * afterwards from an array, with prefetching, instead of by a second walk over the tree.
+ * 
+ * @param rbImageWriter&
+ * @return std::vector<node*>
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::vector<typename RBTree<Key, Value, Compare, Alloc, Aug>::node*>
+RBTree<Key, Value, Compare, Alloc, Aug>::pwriteKeys(rbImageWriter& out)
+{
+    static_assert(!std::is_base_of<typename rbInterval<Key>::fields, node>::value,
+        "images do not hold the end points of an interval tree");
+
+    std::vector<node*> order;
+    order.reserve(nodeCount);
+
+    for (iterator it = begin(), last = end(); it != last; ++it)
+    {
+        out.write(&it->key, sizeof(Key));
+        order.push_back(it.get());
+    }
+
+    return order;
+}
+
+/**
+ * Runs the lookups of n keys interleaved, in the style of asynchronous memory access chaining (AMAC). Up to
+ * BATCH_GROUP lookups are in flight, each being the index of its key and the node it is about to compare against.
+ * The lookups are visited round robin; each visit takes one step down the tree and prefetches the child it moves
+ * to, so by the time the lookup comes around again its node has most likely arrived while the other lookups were
+ * working. A lookup that finds its key or falls off the tree reports the node (or the sentinel) to
+ * finish(index, node*) and its slot takes the next key. Every lookup follows the same path as psearch, so the
+ * results are identical to those of search, and with RBT_STATS each one is counted as a search of its own depth.
+ * 
+ * @param Key*
+ * @param size_t
+ * @param F
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pbatch(const Key* keys, std::size_t n, F finish)
+{
+    struct lookup
+    {
+        std::size_t index;
+        node* at;
+#ifdef RBT_STATS
+        std::size_t depth; // nodes compared so far, starts at zero when a slot takes a new key
+#endif
+    };
+
+    lookup ring[BATCH_GROUP];
+    std::size_t active = 0, next = 0, s = 0;
+
+    for (; active < BATCH_GROUP && next < n; active++, next++)
+        ring[active] = lookup{next, root};
+
+    while (active > 0)
+    {
+        lookup& l = ring[s];
+        node* at = l.at;
+        bool done = at == sentinel;
+
+        if (!done)
+        {
+#ifdef RBT_STATS
+            l.depth++;
+#endif
+            if (comp(at->key, keys[l.index]))
+                at = at->right;
+            else if (comp(keys[l.index], at->key))
+                at = at->left;
+            else
+                done = true;
+        }
+
+        if (!done)
+        {
+            // the key and the child links may sit on either side of a line boundary
+            l.at = at;
+            __builtin_prefetch(&at->key);
+            __builtin_prefetch(&at->right);
+        }
+        else
+        {
+#ifdef RBT_STATS
+            RB_COUNT(searchDepths[l.depth < RB_STATS_DEPTHS ? l.depth : RB_STATS_DEPTHS - 1]);
+            if (at == sentinel)
+                RB_COUNT(searchMisses);
+            else
+                RB_COUNT(searchHits);
+#endif
+            finish(l.index, at);
+
+            if (next < n)
+                l = lookup{next++, root};
+            else
+            {
+                // retire the slot, the last lookup takes its place and is visited next
+                l = ring[--active];
+                if (s < active)
+                    continue;
+            }
+        }
+
+        s = s + 1 < active ? s + 1 : 0;
+    }
+}
+
+/**
+ * Rebuilds the tree from count keys stored back to back at keys, in key order, and the values handed out one after
+ * another by next, which returns false if the value could not be produced. The nodes are allocated in order and
+ * linked with relink once all of them were read; an unreadable value or a key out of order releases the new nodes
+ * and returns false, leaving the current contents untouched. Those are only released on success, node by node since
+ * the pool holds the new nodes as well, so the old and the new nodes are alive together for a moment.
+ * 
+ * @param const char*
+ * @param size_t
+ * @param F
+ * @return bool
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class F>
+bool RBTree<Key, Value, Compare, Alloc, Aug>::prestore(const char* keys, std::size_t count, F next)
+{
+    static_assert(!std::is_base_of<typename rbInterval<Key>::fields, node>::value,
+        "images do not hold the end points of an interval tree");
+
+    bool ok = true;
+    std::vector<node*> order;
+
+    order.reserve(count);
+    nodes.reserve(count);
+
+    for (std::size_t i = 0; ok && i < count; i++)
+    {
+        Key key;
+        Value value = Value();
+
+        std::memcpy(&key, keys + i * sizeof(Key), sizeof(Key));
+        ok = next(value) && (order.empty() || !comp(key, order.back()->key));
+
+        if (ok)
+            order.push_back(instantiateNode(key, std::move(value)));
+    }
+
+    if (!ok)
+    {
+        for (std::size_t i = 0; i < order.size(); i++)
+            destroyNode(order[i]);
+        return false;
+    }
+
+    deleteTree(root);
+    relink(order);
+
+    return true;
+}
+
+/**
+ * Counts the keys less than the given key, or less than or equal to it when inclusive is set. Whenever the descent
+ * moves right past a node, that node and its entire left subtree are counted using the subtree sizes.
+ * 
+ * @param Key&
+ * @param bool
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::countBelow(const Key& key, bool inclusive)
+{
+    static_assert(std::is_base_of<rbOrderStatistic::fields, node>::value,
+        "rank and countRange require the rbOrderStatistic augmentation");
+
+    std::size_t count = 0;
+    node* n = root;
+
+    while (n != sentinel)
+    {
+        if (comp(n->key, key) || (inclusive && !comp(key, n->key)))
+        {
+            count += n->left->size + 1;
+            n = n->right;
+        }
+        else
+            n = n->left;
+    }
+    return count;
+}
+
+/**
+ * In order to move subtrees around the red-black tree we define a routine
+ * which replaces one subtree as a child of its parent with another subtree.
+ * When replacing the subtree rooted at node u with the subtree rooted at node v,
+ * node u's parent becomes node v's parent and u's parent ends up having v as its
+ * appropriate child.
+ * 
+ * @param node*
+ * @param node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::rbTransplant(node* u, node* v)
+{
+    if (u->parent == sentinel) // if u is root
+        root = v; 
+    else if (u == u->parent->left) // if u is left child
+        u->parent->left = v;
+    else
+        u->parent->right = v; // if u is right child
+    
+    // "Exploit" ability to assign v.p when v == T.nil
+    v->parent = u->parent;
+}
+
+/**
+ * When called 3 problems may have arose from the red black tree pdel. First, if y had been
+ * the root and a red child of y becomes the new root, we have violated the root must be black
+ * property. Secondly, if both x and x.p are red, then we have violated that if a node is red,
+ * then both its children are black property. Thirdly, moving y within the tree causes any simple
+ * path that previously contained y to have one fewer black nodes, thus the "for each node, all
+ * simple paths from the node to decendant leaves contain the same number of black nodes" property
+ * is now violated by any ancester of y in the tree.
+ * 
+ * @param node* &
+ * @param node* &
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pdelFixup(node* &root, node* &ptr)
+{
+    /* Goal: Continue to move the 'extra black' up the tree until:
+     *      1. ptr points to a red-and-black node, which we color ptr (singly) black at end.
+     *      2. ptr points to the root, in which case we simply "remove" the extra black, or
+     *      3. Having performed suitable rotations and recolorings, we exit.
+     */
+    RB_COUNT(deleteFixups);
+
+    while ((ptr != root) && (ptr->rbColor == BLACK))
+    {
+        // While in the loop, ptr always points to a nonroot, doubly black node.
+
+        /* Case A:
+         * If ptr is a left child of parent x.p
+         */
+        if (ptr == ptr->parent->left)
+        {
+            // sibling of ptr
+            node* w = ptr->parent->right;
+
+            /* Case 1A:
+             * Sibling is red
+             * 
+             * Since w must have black children, we can switch the colors of w and ptr->parent
+             * then perform a left-rotation on ptr->parent without violating any of the red-black
+             * properties. The new sibling of x, which is one of w's children prior to the rotation,
+             * is now black.
+             */
+            if (w->rbColor == RED)
+            {
+                RB_COUNT(deleteCases[0]);
+                w->rbColor = BLACK;
+                ptr->parent->rbColor = RED;
+                leftRotate(ptr->parent, root);
+                w = ptr->parent->right;
+            }
+
+            /* Case 2A:
+             * Sibling w is black and both of w's children are black
+             * 
+             * Since w and its children are black, we take one black off both ptr and w, leaving
+             * ptr with only one black and leaving w red. To compensate for removing one black from
+             * ptr and w, we would like to add an extra black to ptr->parent, which was originally
+             * red or black. We do so by repeating the while loop with ptr->parent as the new ptr.
+             */
+            if (w->left->rbColor == BLACK && w->right->rbColor == BLACK)
+            {
+                RB_COUNT(deleteCases[1]);
+                w->rbColor = RED;
+                ptr = ptr->parent;
+            }
+
+            /* Case 3A:
+             * Ptr's sibling w is black, w's left child is red, and w's right child is black
+             * 
+             * We can switch out the colors of w and its left child w->left and the perform a 
+             * right rotation on w without violating any red-black properties. The new sibling
+             * w of x is now a black node with a red right child.
+             */
+            else if (w->right->rbColor == BLACK)
+            {
+                RB_COUNT(deleteCases[2]);
+                w->left->rbColor = BLACK;
+                w->rbColor = RED;
+                rightRotate(w, root);
+                w = ptr->parent->right;
+            }
+
+            /* Case 4A:
+             * Ptr's sibling w is black, and w's right child is red
+             * 
+             * By making some color changes and performing a left rotation on ptr->parent, we
+             * can remove the extra black on ptr, making it singly black, without violating
+             * any of the red-black properties. Setting ptr to be root causes the while loop
+             * to terminate.
+             */
+            else
+            {
+                RB_COUNT(deleteCases[3]);
+                w->rbColor = ptr->parent->rbColor;
+                ptr->parent->rbColor = BLACK;
+                w->right->rbColor = BLACK;
+                leftRotate(ptr->parent, root);
+                ptr = root;
+            }
+        }
+        /* Case B:
+         * If ptr is a right child of parent x.p
+         */ 
+        else
+        {
+            // sibling of ptr
+            node* w = ptr->parent->left;
+
+            /* Case 1B:
+             * Sibling is red
+             * 
+             * Since w must have black children, we can switch the colors of w and ptr->parent
+             * then perform a right-rotation on ptr->parent without violating any of the red-black
+             * properties. The new sibling of x, which is one of w's children prior to the rotation,
+             * is now black.
+             */
+            if (w->rbColor == RED)
+            {
+                RB_COUNT(deleteCases[0]);
+                w->rbColor = BLACK;
+                ptr->parent->rbColor = RED;
+                rightRotate(ptr->parent, root);
+                w = ptr->parent->left;
+            }
+
+            /* Case 2B:
+             * Sibling w is black and both of w's children are black
+             * 
+             * Since w and its children are black, we take one black off both ptr and w, leaving
+             * ptr with only one black and leaving w red. To compensate for removing one black from
+             * ptr and w, we would like to add an extra black to ptr->parent, which was originally
+             * red or black. We do so by repeating the while loop with ptr->parent as the new ptr.
+             */
+            if (w->right->rbColor == BLACK && w->left->rbColor == BLACK)
+            {
+                RB_COUNT(deleteCases[1]);
+                w->rbColor = RED;
+                ptr = ptr->parent;
+            }
+
+            /* Case 3B:
+             * Ptr's sibling w is black, w's right child is red, and w's left child is black
+             * 
+             * We can switch out the colors of w and its right child w->right and the perform a 
+             * left rotation on w without violating any red-black properties. The new sibling
+             * w of x is now a black node with a red left child.
+             */
+            else if (w->left->rbColor == BLACK)
+            {
+                RB_COUNT(deleteCases[2]);
+                w->right->rbColor = BLACK;
+                w->rbColor = RED;
+                leftRotate(w, root);
+                w = ptr->parent->left;
+            }
+
+            /* Case 4B:
+             * Ptr's sibling w is black, and w's left child is red
+             * 
+             * By making some color changes and performing a right rotation on ptr->parent, we
+             * can remove the extra black on ptr, making it singly black, without violating
+             * any of the red-black properties. Setting ptr to be root causes the while loop
+             * to terminate.
+             */
+            else
+            {
+                RB_COUNT(deleteCases[3]);
+                w->rbColor = ptr->parent->rbColor;
+                ptr->parent->rbColor = BLACK;
+                w->left->rbColor = BLACK;
+                rightRotate(ptr->parent, root);
+                ptr = root;
+            }
+        }
+    }
+    ptr->rbColor = BLACK;
+}
+
+/**
+ * A simple binary tree insertion call that is used within the private interface for just adding a new node into
+ * the tree structure by walking down the appropriate subtrees from the given node until the sentinel is reached.
+ * The walk is iterative and the key range of the subtree below from has to hold the key of ptr; an empty tree
+ * takes ptr as its root.
+ *  
+ * @param node*
+ * @param node*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pinsert(node* from, node* ptr)
+{
+    if (root == sentinel)
+    {
+        root = ptr;
+        return;
+    }
+
+    node* parent = from;
+    bool right = comp(parent->key, ptr->key);
+    node* next = right ? parent->right : parent->left;
+
+    while (next != sentinel)
+    {
+        parent = next;
+        right = comp(parent->key, ptr->key);
+        next = right ? parent->right : parent->left;
+    }
+
+    ptr->parent = parent;
+    if (right)
+        parent->right = ptr;
+    else
+        parent->left = ptr;
+}
+
+/**
+ * Finds the node from which the insertion of key may descend when placing it just before hint, or just after the
+ * largest node when hint is the sentinel. If the key falls between hint and its predecessor the returned node is
+ * the one the new node is linked to directly. Otherwise the parents of the starting node are climbed: a right
+ * link into a parent makes the parent's key a lower bound of the subtree below, a left link an upper bound. The
+ * nearest bound of each kind decides whether the key lies inside the subtree; a violated bound moves the start up
+ * to that parent, whose own bounds are then looked for further up. Since only the right spine leads to the
+ * largest node, its subtree has no upper bound and the climb only checks the parents as lower bounds.
+ *
+ * @param node*
+ * @param Key&
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pfinger(node* hint, const Key& key)
+{
+    if (root == sentinel)
+        return root;
+
+    if (hint == sentinel)
+    {
+        node* y = rightmost;
+
+        while (y->parent != sentinel && comp(key, y->parent->key))
+            y = y->parent;
+        return y;
+    }
+
+    if (!comp(hint->key, key))
+    {
+        if (hint->left == sentinel)
+        {
+            // without a left subtree the predecessor is the parent at the first right link above hint
+            node* at = hint;
+            node* before = hint->parent;
+
+            while (before != sentinel && at == before->left)
+            {
+                at = before;
+                before = before->parent;
+            }
+
+            if (before == sentinel || !comp(key, before->key))
+                return hint;
+        }
+        else
+        {
+            node* before = pmax(hint->left);
+
+            if (!comp(key, before->key))
+                return before;
+        }
+    }
+
+    node* y = hint;
+    node* at = hint;
+    bool lower = false;
+    bool upper = false;
+
+    while (at->parent != sentinel && !(lower && upper))
+    {
+        node* p = at->parent;
+        bool fromRight = at == p->right;
+        at = p;
+
+        if (fromRight && !lower)
+        {
+            lower = !comp(key, p->key);
+            if (!lower)
+            {
+                y = p;
+                upper = false;
+            }
+        }
+        else if (!fromRight && !upper)
+        {
+            upper = !comp(p->key, key);
+            if (!upper)
+            {
+                y = p;
+                lower = false;
+            }
+        }
+    }
+
+    return y;
+}
+
+/**
+ * Maintains the red-black tree properties by continually recoloring and rotating the tree from bottom to top
+ * until the while loop condition is no longer statisfied.
+ * 
+ * @param node* &
+ * @param node*&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pinsertFixup(node* &root, node* &ptr)
+{
+    node* parent_ptr = sentinel;
+    node* grandparent_ptr = sentinel;
+
+    RB_COUNT(insertFixups);
+
+    // While current ptr is not the root and ptr is red and its parent is also red (adjacent red nodes)
+    while ((ptr != root) && (ptr->rbColor != BLACK) && (ptr->parent->rbColor == RED))
+    {
         parent_ptr = ptr->parent;
         grandparent_ptr = ptr->parent->parent;
 
-        /*
-         * Case: A
-         * Parent of ptr is left child of grandparent of ptr
-         */
-        if (parent_ptr == grandparent_ptr->left)
-        {
-            rbNode<T>* uncle_ptr = grandparent_ptr->right;
-            
-            /*
-             * Case: 1
-             * The uncle of ptr is also red only recoloring is required
-             */
-            if (uncle_ptr != sentinel && uncle_ptr->rbColor == RED)
-            {
-                grandparent_ptr->rbColor = RED;
-                parent_ptr->rbColor = BLACK;
-                uncle_ptr->rbColor = BLACK;
-                ptr = grandparent_ptr;
-            }
-            else
-            {
-                /*
-                 * Case: 2
-                 * ptr is right child of its parent left rotation is required
-                 */
-                if (ptr == parent_ptr->right)
-                {
-                    leftRotate(parent_ptr);
-                    ptr = parent_ptr;
-                    parent_ptr = ptr->parent;
-                }
+        /*
+         * Case: A
+         * Parent of ptr is left child of grandparent of ptr
+         */
+        if (parent_ptr == grandparent_ptr->left)
+        {
+            node* uncle_ptr = grandparent_ptr->right;
+            
+            /*
+             * Case: 1
+             * The uncle of ptr is also red only recoloring is required
+             */
+            if (uncle_ptr != sentinel && uncle_ptr->rbColor == RED)
+            {
+                RB_COUNT(insertCases[0]);
+                grandparent_ptr->rbColor = RED;
+                parent_ptr->rbColor = BLACK;
+                uncle_ptr->rbColor = BLACK;
+                ptr = grandparent_ptr;
+            }
+            else
+            {
+                /*
+                 * Case: 2
+                 * ptr is right child of its parent left rotation is required
+                 */
+                if (ptr == parent_ptr->right)
+                {
+                    RB_COUNT(insertCases[1]);
+                    leftRotate(parent_ptr, root);
+                    ptr = parent_ptr;
+                    parent_ptr = ptr->parent;
+                }
+
+                /*
+                 * Case: 3
+                 * ptr is left child of its parent right rotation is required
+                 */
+                RB_COUNT(insertCases[2]);
+                rightRotate(grandparent_ptr, root);
+                rbColor tmp = (rbColor) parent_ptr->rbColor;
+                parent_ptr->rbColor = grandparent_ptr->rbColor;
+                grandparent_ptr->rbColor = tmp;
+                ptr = parent_ptr;
+            }
+        }
+
+        /*
+         * Case: B
+         * Parent of ptr is right child of grandparent of ptr
+         */ 
+        else 
+        {
+            node* uncle_ptr = grandparent_ptr->left;
+            
+            /*
+             * Case: 1
+             * The uncle of ptr is also red only recoloring is required
+             */
+            if ((uncle_ptr != sentinel) && (uncle_ptr->rbColor == RED))
+            {
+                RB_COUNT(insertCases[0]);
+                grandparent_ptr->rbColor = RED;
+                parent_ptr->rbColor = BLACK;
+                uncle_ptr->rbColor = BLACK;
+                ptr = grandparent_ptr;
+            }
+            else
+            {
+                /*
+                 * Case: 2
+                 * ptr is left child of its parent right rotation is required
+                 */ 
+                if (ptr == parent_ptr->left)
+                {
+                    RB_COUNT(insertCases[1]);
+                    rightRotate(parent_ptr, root);
+                    ptr = parent_ptr;
+                    parent_ptr = ptr->parent;
+                }
+
+                /*
+                 * Case: 3
+                 * ptr is right child of its parent left rotation is required
+                 */
+                RB_COUNT(insertCases[2]);
+                leftRotate(grandparent_ptr, root);
+                rbColor tmp = (rbColor) parent_ptr->rbColor;
+                parent_ptr->rbColor = grandparent_ptr->rbColor;
+                grandparent_ptr->rbColor = tmp;
+                ptr = parent_ptr;
+            }
+        }
+    }
+    root->rbColor = BLACK;
+}
+
+/**
+ * Used during the insertion procedure in order to generate a generic node containing the key and a value
+ * constructed in place from args. The left, right and parent pointers will point to the sentinel until updated at
+ * a later point. Lastly the rbColor is always set to rbColor::RED until otherwise updated later during recoloring
+ * phases. If constructing the value throws, the node storage is handed back before the exception propagates.
+ * 
+ * @param Key&
+ * @param Args&&...
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+template <class... Args>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::instantiateNode(const Key& key, Args&&... args)
+{
+    node* storage = nodes.allocate();
+    node* n;
+
+    try
+    {
+        n = new (storage) node(key, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        nodes.deallocate(storage);
+        throw;
+    }
+
+    n->left = sentinel;
+    n->right = sentinel;
+    n->parent = sentinel;
+    return n;
+}
+
+/**
+ * Links a freshly instantiated node into the tree. The private interface insert places it in the proper location
+ * below from and the tree is then updated to make sure the red black tree properties persist after the insertion.
+ * Finally the sentinel structure will have its left & right pointers reset once the tree root has been initialized.
+ * 
+ * @param node*
+ * @param node*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::attach(node* ptr, node* from)
+{
+    bool init = false;
+    
+    // only true in initialization case 
+    if (root == sentinel)
+        init = true;
+    
+    // add ptr to tree
+    pinsert(from, ptr);
+
+    // rotations keep the order, so a node linked left of the smallest or right of the largest one stays there
+    if (init || leftmost->left == ptr)
+        leftmost = ptr;
+    if (init || rightmost->right == ptr)
+        rightmost = ptr;
+
+    // refresh augmented fields from the new leaf up before any rotation relies on them
+    augmentPath(ptr);
+    
+    // Init is the deterministic condition
+    if (init)
+    {
+        sentinel->left = root;
+        sentinel->right = root;
+        sentinel->parent = root;
+    }
+
+    // rotate and recolor tree
+    pinsertFixup(root, ptr);
+    nodeCount++;
+
+    sentinel->left = root;
+    sentinel->right = root;
+    sentinel->parent = root;
+}
+
+/**
+ * Runs the destructor of a node, and with it those of its key and value, and returns its storage to the allocator.
+ * 
+ * @param node*
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::destroyNode(node* n)
+{
+    n->~node();
+    nodes.deallocate(n);
+}
+
+/**
+ * Descends through the subtrees within the tree until the desired node with the same key is found or sentinel
+ * is reached. If the desired node is found it will be returned, otherwise sentinel is returned. With RBT_STATS
+ * the outcome and the number of nodes compared are counted.
+ * 
+ * @param node*
+ * @param Key&
+ * @return node* 
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::psearch(node* root, const Key& key)
+{
+    std::size_t depth = 0;
+
+    while (root != sentinel)
+    {
+        depth++;
+
+        if (comp(root->key, key))
+            root = root->right;
+        else if (comp(key, root->key))
+            root = root->left;
+        else
+            break;
+    }
+
+#ifdef RBT_STATS
+    RB_COUNT(searchDepths[depth < RB_STATS_DEPTHS ? depth : RB_STATS_DEPTHS - 1]);
+    if (root == sentinel)
+        RB_COUNT(searchMisses);
+    else
+        RB_COUNT(searchHits);
+#endif
+
+    return root;
+}
+
+/**
+ * Recursively prints out the red black tree from top to bottom. If the terminal supports color, the nodes
+ * will be colored respective to the color they possess at the time of the printout.
+ * 
+ * @param node*
+ * @param string
+ * @param bool
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pprint(node* root, std::string indent, bool last) 
+{
+    if (root != sentinel) 
+    {
+        std::cout << indent;
+        if (last)
+        {
+            std::cout<<"R----";
+            indent += "     ";
+        } 
+        else 
+        {
+            std::cout<<"L----";
+            indent += "|    ";
+        }
+
+        if (root->rbColor == BLACK)
+            std::cout << "\033[1;30m" << root->key <<"("<<"BLACK"<<")" << "\033[0m" << std::endl;
+        else // RED
+            std::cout << "\033[1;31m" << root->key <<"("<<"RED"<<")" << "\033[0m" << std::endl;
+        pprint(root->left, indent, false);
+        pprint(root->right, indent, true);
+    }
+}
+
+/**
+ * Recursively links count nodes taken in key order from the order array into a subtree whose root is the middle
+ * node. Splitting every range in half keeps the sizes of sibling subtrees within one of each other, which means
+ * every level above fullDepth is completely filled and only the deepest level can be partial. Coloring the
+ * nodes on that partial level red and every other node black gives each path from the root to the sentinel
+ * exactly fullDepth black nodes and never puts a red node under another red node, so the result is a valid red
+ * black tree without any rotations.
+ * 
+ * @param node**
+ * @param size_t
+ * @param size_t
+ * @param size_t
+ * @param node*
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pbuild(node** order, std::size_t count, std::size_t depth,
+    std::size_t fullDepth, node* parent)
+{
+    if (count == 0)
+        return sentinel;
+
+    std::size_t leftCount = (count - 1) / 2;
+    node* n = order[leftCount];
+
+    n->parent = parent;
+    n->left = pbuild(order, leftCount, depth + 1, fullDepth, n);
+    n->right = pbuild(order + leftCount + 1, count - leftCount - 1, depth + 1, fullDepth, n);
+    n->rbColor = depth >= fullDepth ? RED : BLACK;
+
+    Aug::update(n);
+    return n;
+}
+
+/**
+ * Returns how many levels of the set operation recursion may still fork onto another thread. Forking a couple of
+ * levels deeper than the thread count strictly needs gives some slack when the two halves are uneven.
+ * 
+ * @return int
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+int RBTree<Key, Value, Compare, Alloc, Aug>::forkDepth()
+{
+    if (parallelism <= 1)
+        return 0;
+
+    int depth = 0;
+    while ((1u << depth) < parallelism)
+        depth++;
+    return depth + 2;
+}
+
+/**
+ * Returns the black height of the subtree rooted at n, counting n itself when it is black, where leaf is the
+ * sentinel of the tree the subtree belongs to. Every path has the same number of black nodes so the left spine
+ * is as good as any.
+ * 
+ * @param node*
+ * @param node*
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::blackHeight(node* n, node* leaf)
+{
+    std::size_t height = 0;
+
+    for (; n != leaf; n = n->left)
+    {
+        if (n->rbColor == BLACK)
+            height++;
+    }
+    return height;
+}
+
+/**
+ * Accumulates the height of the subtree rooted at n and the sum of the depths of its nodes, n being at the given
+ * depth.
+ * 
+ * @param node*
+ * @param size_t
+ * @param size_t&
+ * @param double&
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::pshape(node* n, std::size_t depth, std::size_t& height, double& depthSum)
+{
+    for (; n != sentinel; n = n->right, depth++)
+    {
+        if (depth > height)
+            height = depth;
+
+        depthSum += depth;
+        pshape(n->left, depth + 1, height, depthSum);
+    }
+}
+
+/**
+ * Joins the detached subtrees l and r around the detached node k, where no key of l is greater than k's key and no
+ * key of r is smaller. This is the join described in 'Introduction to Algorithms' problem 13-2. Both roots are
+ * first made black, which keeps each a valid red black tree. If the black heights match, k simply becomes a black
+ * root over both. Otherwise k is colored red and hung in place of the black node with matching black height on
+ * the inner spine of the taller tree, and pinsertFixup restores the red black properties within that tree. The
+ * cost is proportional to the difference in black heights. The returned root has the sentinel as its parent.
+ * None of the steps write to the sentinel, so joins on disjoint subtrees may run on different threads.
+ * 
+ * @param node*
+ * @param node*
+ * @param node*
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pjoin(node* l, node* k, node* r)
+{
+    if (l != sentinel)
+    {
+        l->parent = sentinel;
+        l->rbColor = BLACK;
+    }
+    if (r != sentinel)
+    {
+        r->parent = sentinel;
+        r->rbColor = BLACK;
+    }
+
+    std::size_t hl = blackHeight(l, sentinel);
+    std::size_t hr = blackHeight(r, sentinel);
+
+    if (hl == hr)
+    {
+        k->left = l;
+        k->right = r;
+        k->parent = sentinel;
+        k->rbColor = BLACK;
+        if (l != sentinel)
+            l->parent = k;
+        if (r != sentinel)
+            r->parent = k;
+        Aug::update(k);
+        return k;
+    }
+
+    node* top = hl > hr ? l : r;
+    node* y = top;
+    node* p = sentinel;
+    std::size_t h = hl > hr ? hl : hr;
+    std::size_t target = hl > hr ? hr : hl;
+
+    // walk the inner spine of the taller tree until a black node of the shorter tree's black height is found
+    while (!(y->rbColor == BLACK && h == target))
+    {
+        if (y->rbColor == BLACK)
+            h--;
+        p = y;
+        y = hl > hr ? y->right : y->left;
+    }
+
+    if (hl > hr)
+    {
+        k->left = y;
+        k->right = r;
+        p->right = k;
+    }
+    else
+    {
+        k->left = l;
+        k->right = y;
+        p->left = k;
+    }
+
+    k->parent = p;
+    k->rbColor = RED;
+    if (k->left != sentinel)
+        k->left->parent = k;
+    if (k->right != sentinel)
+        k->right->parent = k;
+
+    augmentPath(k);
+    pinsertFixup(top, k);
+
+    return top;
+}
+
+/**
+ * Concatenates the detached subtrees l and r, where no key of l is greater than any key of r, by taking the
+ * maximum of l out and using it as the middle node of a join.
+ * 
+ * @param node*
+ * @param node*
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pjoin2(node* l, node* r)
+{
+    if (l == sentinel)
+    {
+        if (r != sentinel)
+            r->parent = sentinel;
+        return r;
+    }
+    if (r == sentinel)
+    {
+        l->parent = sentinel;
+        return l;
+    }
+
+    node* rest;
+    node* last = psplitLast(l, rest);
+    return pjoin(rest, last, r);
+}
+
+/**
+ * Detaches the maximum node of the subtree t and returns it, rest receives the remaining subtree. Each level of
+ * the right spine is rejoined on the way back up, which costs O(log n) in total.
+ * 
+ * @param node*
+ * @param node* &
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::psplitLast(node* t, node* &rest)
+{
+    node* l = t->left;
+    node* r = t->right;
+
+    if (r == sentinel)
+    {
+        if (l != sentinel)
+            l->parent = sentinel;
+        rest = l;
+        return t;
+    }
+
+    node* remaining;
+    node* last = psplitLast(r, remaining);
+    rest = pjoin(l, t, remaining);
+    return last;
+}
+
+/**
+ * Splits the detached subtree t into l holding every key less than key, or less than or equal to key when
+ * inclusive is set, and r holding the rest. The split follows the search path for key and joins the subtrees hanging
+ * off that path back together on the way up, which costs O(log n) in total since the black heights of the joined
+ * pieces only ever grow along the path.
+ * 
+ * @param node*
+ * @param Key&
+ * @param bool
+ * @param node* &
+ * @param node* &
+ * @return void
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+void RBTree<Key, Value, Compare, Alloc, Aug>::psplit(node* t, const Key& key, bool inclusive, node* &l, node* &r)
+{
+    if (t == sentinel)
+    {
+        l = sentinel;
+        r = sentinel;
+        return;
+    }
+
+    node* left = t->left;
+    node* right = t->right;
+
+    if (comp(t->key, key) || (inclusive && !comp(key, t->key)))
+    {
+        node* rl;
+        psplit(right, key, inclusive, rl, r);
+        l = pjoin(left, t, rl);
+    }
+    else
+    {
+        node* lr;
+        psplit(left, key, inclusive, l, lr);
+        r = pjoin(lr, t, right);
+    }
+}
+
+/**
+ * Points every leaf reference of the subtree n that still refers to the sentinel of the tree it came from at this
+ * tree's sentinel instead, and returns the number of nodes visited. Needed whenever nodes move between trees since
+ * each tree has a sentinel of its own. Above the grain size the two children are handled on separate threads.
+ * 
+ * @param node*
+ * @param node*
+ * @param int
+ * @return size_t
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+std::size_t RBTree<Key, Value, Compare, Alloc, Aug>::pretarget(node* n, node* from, int depth)
+{
+    if (n == from || n == sentinel)
+        return 0;
 
-                /*
-                 * Case: 3
-                 * ptr is left child of its parent right rotation is required
-                 */
-                rightRotate(grandparent_ptr);
-                rbColor tmp = (rbColor) parent_ptr->rbColor;
-                parent_ptr->rbColor = grandparent_ptr->rbColor;
-                grandparent_ptr->rbColor = tmp;
-                ptr = parent_ptr;
-            }
-        }
+    if (n->left == from)
+        n->left = sentinel;
+    if (n->right == from)
+        n->right = sentinel;
 
-        /*
-         * Case: B
-         * Parent of ptr is right child of grandparent of ptr
-         */ 
-        else 
-        {
-            rbNode<T>* uncle_ptr = grandparent_ptr->left;
-            
-            /*
-             * Case: 1
-             * The uncle of ptr is also red only recoloring is required
-             */
-            if ((uncle_ptr != sentinel) && (uncle_ptr->rbColor == RED))
-            {
-                grandparent_ptr->rbColor = RED;
-                parent_ptr->rbColor = BLACK;
-                uncle_ptr->rbColor = BLACK;
-                ptr = grandparent_ptr;
-            }
-            else
-            {
-                /*
-                 * Case: 2
-                 * ptr is left child of its parent right rotation is required
-                 */ 
-                if (ptr == parent_ptr->left)
-                {
-                    rightRotate(parent_ptr);
-                    ptr = parent_ptr;
-                    parent_ptr = ptr->parent;
-                }
+    // the leaves below n->right still refer to from, a sentinel child is never worth a thread
+    if (depth > 0 && n->right != sentinel && blackHeight(n->right, from) >= PARALLEL_GRAIN)
+    {
+        std::future<std::size_t> right = std::async(std::launch::async, &RBTree::pretarget, this, n->right, from, 
+            depth - 1);
+        std::size_t count = pretarget(n->left, from, depth - 1);
+        return count + right.get() + 1;
+    }
 
-                /*
-                 * Case: 3
-                 * ptr is right child of its parent left rotation is required
-                 */
-                leftRotate(grandparent_ptr);
-                rbColor tmp = (rbColor) parent_ptr->rbColor;
-                parent_ptr->rbColor = grandparent_ptr->rbColor;
-                grandparent_ptr->rbColor = tmp;
-                ptr = parent_ptr;
-            }
-        }
+    return pretarget(n->left, from, 0) + pretarget(n->right, from, 0) + 1;
+}
+
+/**
+ * Join based union of the detached subtrees a and b, both of which use this tree's sentinel. The root of b is
+ * exposed, a is split around its key and the left and right halves are merged independently before the root of
+ * b joins them back together.
+ * 
+ * @param node*
+ * @param node*
+ * @param int
+ * @return node*
+ */
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::punion(node* a, node* b, int depth)
+{
+    if (a == sentinel)
+    {
+        if (b != sentinel)
+            b->parent = sentinel;
+        return b;
     }
-    root->rbColor = BLACK;
+    if (b == sentinel)
+    {
+        a->parent = sentinel;
+        return a;
+    }
+
+    bool fork = depth > 0 && 
+        (blackHeight(a, sentinel) >= PARALLEL_GRAIN || blackHeight(b, sentinel) >= PARALLEL_GRAIN);
+
+    node* l1;
+    node* r1;
+    node* l2 = b->left;
+    node* r2 = b->right;
+    psplit(a, b->key, false, l1, r1);
+
+    node* tl;
+    node* tr;
+
+    if (fork)
+    {
+        std::future<node*> right = std::async(std::launch::async, &RBTree::punion, this, r1, r2, depth - 1);
+        tl = punion(l1, l2, depth - 1);
+        tr = right.get();
+    }
+    else
+    {
+        tl = punion(l1, l2, 0);
+        tr = punion(r1, r2, 0);
+    }
+
+    return pjoin(tl, b, tr);
 }
 
 /**
- * Used during the insertion procedure in order to generate a generic node containing the key & data passed.
- * The left, right and parent pointers will point to the sentinel until updated at a later point.
- * Lastly the rbColor is always set to rbColor::RED until otherwise updated later during recoloring phases.
+ * Join based intersection of the detached subtree a of this tree with the subtree b of another tree whose
+ * sentinel is leaf. Only nodes of a are kept, b is only read. The nodes of a holding the root key of b are split
+ * out and kept, everything of a is dropped into garbage once b runs out.
  * 
- * @param unsigned long long
- * @param T
- * @return rbNode<T>*
+ * @param node*
+ * @param node*
+ * @param node*
+ * @param int
+ * @param vector<node*>&
+ * @return node*
  */
-template <class T>
-rbNode<T>* RBT<T>::instantiateNode(unsigned long long key, T* data)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pintersect(node* a, node* b, node* leaf, int depth,
+    std::vector<node*>& garbage)
 {
-    rbNode<T>* n = new rbNode<T>;
-    n->key = key;
-    n->data = data;
-    n->left = sentinel;
-    n->right = sentinel;
-    n->parent = sentinel;
-    n->rbColor = RED;
-    return n;
+    if (a == sentinel)
+        return sentinel;
+    if (b == leaf)
+    {
+        garbage.push_back(a);
+        return sentinel;
+    }
+
+    bool fork = depth > 0 && (blackHeight(a, sentinel) >= PARALLEL_GRAIN || blackHeight(b, leaf) >= PARALLEL_GRAIN);
+
+    node* l1;
+    node* rest;
+    node* equal;
+    node* r1;
+    psplit(a, b->key, false, l1, rest);
+    psplit(rest, b->key, true, equal, r1);
+
+    node* tl;
+    node* tr;
+
+    if (fork)
+    {
+        std::vector<node*> rightGarbage;
+        std::future<node*> right = std::async(std::launch::async, &RBTree::pintersect, this, r1, b->right, 
+            leaf, depth - 1, std::ref(rightGarbage));
+        tl = pintersect(l1, b->left, leaf, depth - 1, garbage);
+        tr = right.get();
+        garbage.insert(garbage.end(), rightGarbage.begin(), rightGarbage.end());
+    }
+    else
+    {
+        tl = pintersect(l1, b->left, leaf, 0, garbage);
+        tr = pintersect(r1, b->right, leaf, 0, garbage);
+    }
+
+    if (equal == sentinel)
+        return pjoin2(tl, tr);
+    if (equal->left == sentinel && equal->right == sentinel)
+        return pjoin(tl, equal, tr);
+    return pjoin2(pjoin2(tl, equal), tr);
 }
 
 /**
- * Recursively traverses through the subtrees within the tree until the desired rbNode with the same key
- * is found or sentinel is reached. If the desired node is found it will be returned, otherwise sentinel 
- * is returned.
+ * Join based difference of the detached subtree a of this tree and the subtree b of another tree whose sentinel
+ * is leaf. The nodes of a holding the root key of b are split out into garbage and the remaining halves are
+ * reduced independently before being concatenated.
  * 
- * @param rbNode<T>*
- * @param unsigned long long
- * @return rbNode<T>* 
+ * @param node*
+ * @param node*
+ * @param node*
+ * @param int
+ * @param vector<node*>&
+ * @return node*
  */
-template <class T>
-rbNode<T>* RBT<T>::psearch(rbNode<T>* root, unsigned long long key)
+template <class Key, class Value, class Compare, template <class> class Alloc, class Aug>
+typename RBTree<Key, Value, Compare, Alloc, Aug>::node*
+RBTree<Key, Value, Compare, Alloc, Aug>::pdifference(node* a, node* b, node* leaf, int depth,
+    std::vector<node*>& garbage)
 {
-    if (root == sentinel)
+    if (a == sentinel)
         return sentinel;
-    else if (root->key == key)
-        return root;
-    
-    if (key > root->key)
-        return psearch(root->right, key);
+    if (b == leaf)
+    {
+        a->parent = sentinel;
+        return a;
+    }
+
+    bool fork = depth > 0 && (blackHeight(a, sentinel) >= PARALLEL_GRAIN || blackHeight(b, leaf) >= PARALLEL_GRAIN);
+
+    node* l1;
+    node* rest;
+    node* equal;
+    node* r1;
+    psplit(a, b->key, false, l1, rest);
+    psplit(rest, b->key, true, equal, r1);
+
+    if (equal != sentinel)
+        garbage.push_back(equal);
+
+    node* tl;
+    node* tr;
+
+    if (fork)
+    {
+        std::vector<node*> rightGarbage;
+        std::future<node*> right = std::async(std::launch::async, &RBTree::pdifference, this, r1, b->right, 
+            leaf, depth - 1, std::ref(rightGarbage));
+        tl = pdifference(l1, b->left, leaf, depth - 1, garbage);
+        tr = right.get();
+        garbage.insert(garbage.end(), rightGarbage.begin(), rightGarbage.end());
+    }
     else
-        return psearch(root->left, key);
+    {
+        tl = pdifference(l1, b->left, leaf, 0, garbage);
+        tr = pdifference(r1, b->right, leaf, 0, garbage);
+    }
+
+    return pjoin2(tl, tr);
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                                 NODES                                                   ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
 /**
- * Recursively prints out the red black tree from top to bottom. If the terminal supports color, the nodes
- * will be colored respective to the color they possess at the time of the printout.
+ * Creates a black node with default constructed key and value and cleared augmented fields, used for the
+ * sentinel.
  * 
- * @param rbNode<T>*
- * @param string
- * @param bool
- * @return void
+ * @return this
  */
-template <class T>
-void RBT<T>::pprint(rbNode<T>* root, std::string indent, bool last) 
+template <class Key, class Value, class Aug>
+rbTreeNode<Key, Value, Aug>::rbTreeNode() : Aug::fields(), data(), rbColor(BLACK), key()
 {
-    if (root != sentinel) 
+    left = nullptr;
+    right = nullptr;
+    parent = nullptr;
+}
+
+/**
+ * Creates a red node holding key whose value is constructed in place from args. The links are set by the tree.
+ * 
+ * @param Key&
+ * @param Args&&...
+ * @return this
+ */
+template <class Key, class Value, class Aug>
+template <class... Args>
+rbTreeNode<Key, Value, Aug>::rbTreeNode(const Key& key, Args&&... args)
+    : Aug::fields(), data(std::forward<Args>(args)...), rbColor(RED), key(key)
+{
+    left = nullptr;
+    right = nullptr;
+    parent = nullptr;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                                  ITERATOR                                               ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Creates a singular iterator which is not attached to any tree.
+ * 
+ * @return this
+ */
+template <class N>
+rbIterator<N>::rbIterator()
+{
+    node = nullptr;
+    sentinel = nullptr;
+}
+
+/**
+ * Creates an iterator positioned on node within the tree owning the given sentinel.
+ * 
+ * @param N*
+ * @param N*
+ * @return this
+ */
+template <class N>
+rbIterator<N>::rbIterator(N* node, N* sentinel)
+{
+    this->node = node;
+    this->sentinel = sentinel;
+}
+
+/**
+ * Returns the node the iterator is positioned on, which is the sentinel for the end iterator.
+ * 
+ * @return N*
+ */
+template <class N>
+N* rbIterator<N>::get() const
+{
+    return node;
+}
+
+/**
+ * Returns a reference to the current node.
+ * 
+ * @return N&
+ */
+template <class N>
+N& rbIterator<N>::operator*() const
+{
+    return *node;
+}
+
+/**
+ * Returns a pointer to the current node.
+ * 
+ * @return N*
+ */
+template <class N>
+N* rbIterator<N>::operator->() const
+{
+    return node;
+}
+
+/**
+ * Advances to the in order successor. If the node has a right subtree the successor is its minimum, otherwise we
+ * climb until we arrive from a left child. Climbing past the root reaches the sentinel, which is the end position.
+ * 
+ * @return rbIterator&
+ */
+template <class N>
+rbIterator<N>& rbIterator<N>::operator++()
+{
+    if (node->right != sentinel)
     {
-        std::cout << indent;
-        if (last)
-        {
-            std::cout<<"R----";
-            indent += "     ";
-        } 
-        else 
-        {
-            std::cout<<"L----";
-            indent += "|    ";
-        }
+        node = node->right;
+        while (node->left != sentinel)
+            node = node->left;
+        return *this;
+    }
 
-        if (root->rbColor == BLACK)
-            std::cout << "\033[1;30m" << root->key <<"("<<"BLACK"<<")" << "\033[0m" << std::endl;
-        else // RED
-            std::cout << "\033[1;31m" << root->key <<"("<<"RED"<<")" << "\033[0m" << std::endl;
-        pprint(root->left, indent, false);
-        pprint(root->right, indent, true);
+    N* p = node->parent;
+    while (p != sentinel && node == p->right)
+    {
+        node = p;
+        p = p->parent;
+    }
+    node = p;
+    return *this;
+}
+
+/**
+ * Steps back to the in order predecessor. Stepping back from the end position moves onto the maximum of the tree,
+ * which is reached through the root kept on the sentinel's left pointer.
+ * 
+ * @return rbIterator&
+ */
+template <class N>
+rbIterator<N>& rbIterator<N>::operator--()
+{
+    if (node == sentinel)
+    {
+        node = sentinel->left;
+        while (node != sentinel && node->right != sentinel)
+            node = node->right;
+        return *this;
     }
+
+    if (node->left != sentinel)
+    {
+        node = node->left;
+        while (node->right != sentinel)
+            node = node->right;
+        return *this;
+    }
+
+    N* p = node->parent;
+    while (p != sentinel && node == p->left)
+    {
+        node = p;
+        p = p->parent;
+    }
+    node = p;
+    return *this;
+}
+
+/**
+ * Postfix form of the increment operator.
+ * 
+ * @param int
+ * @return rbIterator
+ */
+template <class N>
+rbIterator<N> rbIterator<N>::operator++(int)
+{
+    rbIterator<N> prev = *this;
+    ++(*this);
+    return prev;
+}
+
+/**
+ * Postfix form of the decrement operator.
+ * 
+ * @param int
+ * @return rbIterator
+ */
+template <class N>
+rbIterator<N> rbIterator<N>::operator--(int)
+{
+    rbIterator<N> prev = *this;
+    --(*this);
+    return prev;
+}
+
+/**
+ * Two iterators are equal when they are positioned on the same node.
+ * 
+ * @param rbIterator&
+ * @return bool
+ */
+template <class N>
+bool rbIterator<N>::operator==(const rbIterator& other) const
+{
+    return node == other.node;
+}
+
+/**
+ * Two iterators differ when they are positioned on different nodes.
+ * 
+ * @param rbIterator&
+ * @return bool
+ */
+template <class N>
+bool rbIterator<N>::operator!=(const rbIterator& other) const
+{
+    return node != other.node;
 }
\ No newline at end of file
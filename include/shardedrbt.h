@@ -0,0 +1,64 @@
+#ifndef SHARDEDRBT_H
+#define  SHARDEDRBT_H
+
+#include <memory>
+#include <vector>
+#include <cstddef>
+#include <shared_mutex>
+#include "rbt.h"
+
+#define DEFAULT_SHARD_COUNT 16
+
+/**
+ * A thread safe red black tree header file containing all appropriate declarations.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/**
+ * Concurrent front end which partitions the unsigned long long key space into contiguous ranges and keeps each
+ * range in its own RBT guarded by its own reader/writer lock. Lookups on a shard share its lock while updates take
+ * it exclusively, so threads working on different shards never wait on each other and readers of the same shard
+ * proceed together. Because the shards cover ascending key ranges, ordered iteration and range scans simply visit
+ * the shards in order, each under its shared lock. A scan is consistent within every shard but not across shards.
+ */
+template <class T, template <class> class Alloc = rbNodePool, class Aug = rbPlain>
+class ShardedRBT
+{
+    public:
+        ShardedRBT(std::size_t shards = DEFAULT_SHARD_COUNT);
+        ShardedRBT(const std::vector<unsigned long long>& bounds);
+        void clear();
+        bool isEmpty();
+        std::size_t size();
+        template <class F>
+        void forEach(F fn);
+        std::size_t shardCount();
+        T* search(unsigned long long key);
+        bool del(unsigned long long key);
+        bool contains(unsigned long long key);
+        void insert(unsigned long long key, T* data);
+        template <class F>
+        void forEachInRange(unsigned long long lo, unsigned long long hi, F fn);
+
+    private:
+        /**
+         * A single key range and its lock, aligned so neighbouring locks do not share a cache line.
+         */
+        struct alignas(64) rbShard
+        {
+            std::shared_mutex lock;
+            RBT<T, Alloc, Aug> tree;
+        };
+
+        std::vector<unsigned long long> lowerBounds;
+        std::vector<std::unique_ptr<rbShard>> shards;
+
+        std::size_t shardOf(unsigned long long key);
+};
+
+// Include templated implementation file as it is necessary to present during compile time
+#include "shardedrbt.tpp"
+
+#endif
@@ -0,0 +1,240 @@
+#include "shardedrbt.h"
+#include <mutex>
+#include <algorithm>
+
+/**
+ * A thread safe red black tree template implementation file which contains the logic for spreading keys over the
+ * shards and taking the appropriate shard locks around every operation.
+ *
+ * @author Vincent Nigro
+ * @version 0.0.1
+ */
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                             PUBLIC INTERFACE                                            ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Splits the whole key space into the given number of equally wide, contiguous ranges. At least one shard is
+ * always created.
+ *
+ * @param size_t
+ * @return this
+ */
+template <class T, template <class> class Alloc, class Aug>
+ShardedRBT<T, Alloc, Aug>::ShardedRBT(std::size_t shards)
+{
+    if (shards == 0)
+        shards = 1;
+
+    unsigned long long width = ~0ULL / shards;
+
+    for (std::size_t i = 0; i < shards; i++)
+    {
+        lowerBounds.push_back(i * width);
+        this->shards.push_back(std::unique_ptr<rbShard>(new rbShard));
+    }
+}
+
+/**
+ * Splits the key space at the given keys, each of which becomes the lowest key of a new shard. This allows the
+ * shards to follow a skewed key distribution, for instance timestamps which all fall into a narrow range.
+ *
+ * @param vector<unsigned long long>&
+ * @return this
+ */
+template <class T, template <class> class Alloc, class Aug>
+ShardedRBT<T, Alloc, Aug>::ShardedRBT(const std::vector<unsigned long long>& bounds)
+{
+    lowerBounds.push_back(0);
+    lowerBounds.insert(lowerBounds.end(), bounds.begin(), bounds.end());
+
+    std::sort(lowerBounds.begin(), lowerBounds.end());
+    lowerBounds.erase(std::unique(lowerBounds.begin(), lowerBounds.end()), lowerBounds.end());
+
+    for (std::size_t i = 0; i < lowerBounds.size(); i++)
+        shards.push_back(std::unique_ptr<rbShard>(new rbShard));
+}
+
+/**
+ * Removes every element from every shard, taking each shard lock exclusively in turn.
+ *
+ * @return void
+ */
+template <class T, template <class> class Alloc, class Aug>
+void ShardedRBT<T, Alloc, Aug>::clear()
+{
+    for (std::size_t i = 0; i < shards.size(); i++)
+    {
+        std::unique_lock<std::shared_mutex> guard(shards[i]->lock);
+        shards[i]->tree.clear();
+    }
+}
+
+/**
+ * Returns true if no shard holds any element at the time it is looked at.
+ *
+ * @return bool
+ */
+template <class T, template <class> class Alloc, class Aug>
+bool ShardedRBT<T, Alloc, Aug>::isEmpty()
+{
+    return size() == 0;
+}
+
+/**
+ * Returns the sum of the shard sizes, each read under its shared lock.
+ *
+ * @return size_t
+ */
+template <class T, template <class> class Alloc, class Aug>
+std::size_t ShardedRBT<T, Alloc, Aug>::size()
+{
+    std::size_t total = 0;
+
+    for (std::size_t i = 0; i < shards.size(); i++)
+    {
+        std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+        total += shards[i]->tree.size();
+    }
+    return total;
+}
+
+/**
+ * Calls fn with every node in key order. Shards are visited in ascending order, each under its shared lock, so fn
+ * must not call back into this structure for the same shard and must not keep the node past its return.
+ *
+ * @param F
+ * @return void
+ */
+template <class T, template <class> class Alloc, class Aug>
+template <class F>
+void ShardedRBT<T, Alloc, Aug>::forEach(F fn)
+{
+    for (std::size_t i = 0; i < shards.size(); i++)
+    {
+        std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+        RBT<T, Alloc, Aug>& tree = shards[i]->tree;
+
+        for (typename RBT<T, Alloc, Aug>::iterator it = tree.begin(); it != tree.end(); ++it)
+            fn(it.get());
+    }
+}
+
+/**
+ * Returns the number of shards the key space is split into.
+ *
+ * @return size_t
+ */
+template <class T, template <class> class Alloc, class Aug>
+std::size_t ShardedRBT<T, Alloc, Aug>::shardCount()
+{
+    return shards.size();
+}
+
+/**
+ * Looks up key under the shared lock of its shard and returns the data stored with it, or nullptr if the key is
+ * not present. Only the data pointer is handed out since the node itself may be removed as soon as the lock is
+ * dropped.
+ *
+ * @param unsigned long long
+ * @return T*
+ */
+template <class T, template <class> class Alloc, class Aug>
+T* ShardedRBT<T, Alloc, Aug>::search(unsigned long long key)
+{
+    rbShard& shard = *shards[shardOf(key)];
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+
+    rbNode<T, Aug>* n = shard.tree.search(key);
+
+    if (n == shard.tree.getSentinel())
+        return nullptr;
+    return n->data;
+}
+
+/**
+ * Deletes one element holding key under the exclusive lock of its shard, returns false if the key is not present.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T, template <class> class Alloc, class Aug>
+bool ShardedRBT<T, Alloc, Aug>::del(unsigned long long key)
+{
+    rbShard& shard = *shards[shardOf(key)];
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+
+    return shard.tree.del(key);
+}
+
+/**
+ * Returns true if key is present, looked up under the shared lock of its shard.
+ *
+ * @param unsigned long long
+ * @return bool
+ */
+template <class T, template <class> class Alloc, class Aug>
+bool ShardedRBT<T, Alloc, Aug>::contains(unsigned long long key)
+{
+    rbShard& shard = *shards[shardOf(key)];
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+
+    return shard.tree.search(key) != shard.tree.getSentinel();
+}
+
+/**
+ * Inserts key and data under the exclusive lock of the shard covering key.
+ *
+ * @param unsigned long long
+ * @param T*
+ * @return void
+ */
+template <class T, template <class> class Alloc, class Aug>
+void ShardedRBT<T, Alloc, Aug>::insert(unsigned long long key, T* data)
+{
+    rbShard& shard = *shards[shardOf(key)];
+    std::unique_lock<std::shared_mutex> guard(shard.lock);
+
+    shard.tree.insert(key, data);
+}
+
+/**
+ * Calls fn with every node whose key lies in [lo, hi), in key order. Only the shards whose ranges overlap the
+ * query are visited, one at a time under their shared locks, and each of them answers with its own O(log n + k)
+ * range scan.
+ *
+ * @param unsigned long long
+ * @param unsigned long long
+ * @param F
+ * @return void
+ */
+template <class T, template <class> class Alloc, class Aug>
+template <class F>
+void ShardedRBT<T, Alloc, Aug>::forEachInRange(unsigned long long lo, unsigned long long hi, F fn)
+{
+    if (lo >= hi)
+        return;
+
+    for (std::size_t i = shardOf(lo); i < shards.size() && lowerBounds[i] < hi; i++)
+    {
+        std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+        shards[i]->tree.forEachInRange(lo, hi, fn);
+    }
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              PRIVATE INTERFACE                                          ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Returns the index of the shard whose range contains key, the last shard whose lower bound is not above key.
+ *
+ * @param unsigned long long
+ * @return size_t
+ */
+template <class T, template <class> class Alloc, class Aug>
+std::size_t ShardedRBT<T, Alloc, Aug>::shardOf(unsigned long long key)
+{
+    return std::upper_bound(lowerBounds.begin(), lowerBounds.end(), key) - lowerBounds.begin() - 1;
+}
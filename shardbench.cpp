@@ -0,0 +1,156 @@
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include "include/shardedrbt.h"
+
+using namespace std;
+using namespace chrono;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                          SHARDED TREE BENCHMARK                                         ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Baseline which serializes every operation on a plain RBT behind one mutex, the setup ShardedRBT replaces.
+ */
+struct lockedTree
+{
+    mutex lock;
+    RBT<int> tree;
+
+    bool contains(unsigned long long key)
+    {
+        lock_guard<mutex> guard(lock);
+        return tree.search(key) != tree.getSentinel();
+    }
+
+    void insert(unsigned long long key, int* data)
+    {
+        lock_guard<mutex> guard(lock);
+        tree.insert(key, data);
+    }
+
+    bool del(unsigned long long key)
+    {
+        lock_guard<mutex> guard(lock);
+        return tree.del(key);
+    }
+};
+
+template <class Tree>
+double runMixed(Tree&, int, unsigned long long, unsigned long long);
+
+/**
+ * Preloads both a single mutex tree and a sharded tree with the same random keys and then runs the same mixed
+ * workload (80% lookups, 10% inserts, 10% deletes) against each with 1, 2, 4, ... threads up to the requested
+ * maximum, reporting the throughput of both and the speedup of the sharded tree. Every run uses fixed seeds.
+ *
+ * Usage: RBT_SHARD_BENCH [max threads] [shards] [preloaded keys] [operations per thread]
+ *
+ * @param int
+ * @param char**
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    int maxThreads = argc > 1 ? atoi(argv[1]) : thread::hardware_concurrency();
+    size_t shardCount = argc > 2 ? strtoull(argv[2], nullptr, 10) : DEFAULT_SHARD_COUNT;
+    unsigned long long keyCount = argc > 3 ? strtoull(argv[3], nullptr, 10) : 1000000;
+    unsigned long long opsPerThread = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1000000;
+
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    int data = 0;
+    lockedTree baseline;
+    ShardedRBT<int> sharded(shardCount);
+    mt19937_64 rng(42);
+
+    for (unsigned long long i = 0; i < keyCount; i++)
+    {
+        unsigned long long key = rng();
+        baseline.tree.insert(key, &data);
+        sharded.insert(key, &data);
+    }
+
+    cout << keyCount << " keys preloaded, " << shardCount << " shards, " << opsPerThread
+         << " operations per thread." << endl;
+    cout << setw(8) << "threads" << setw(20) << "single mutex Mops/s" << setw(16) << "sharded Mops/s"
+         << setw(10) << "speedup" << endl;
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2)
+    {
+        double locked = runMixed(baseline, threads, opsPerThread, keyCount);
+        double split = runMixed(sharded, threads, opsPerThread, keyCount);
+
+        cout << setw(8) << threads << fixed << setprecision(2) << setw(20) << locked << setw(16) << split
+             << setw(10) << split / locked << endl;
+    }
+
+    return 0;
+}
+
+/**
+ * Runs the mixed workload on the given number of threads and returns the combined throughput in millions of
+ * operations per second. Lookups draw from the same random stream the tree was preloaded with so most of them
+ * hit, inserts add fresh random keys and deletes remove keys that were inserted earlier by the same thread, which
+ * keeps the tree size stable between runs.
+ *
+ * @param Tree&
+ * @param int
+ * @param unsigned long long
+ * @param unsigned long long
+ * @return double
+ */
+template <class Tree>
+double runMixed(Tree& tree, int threads, unsigned long long ops, unsigned long long keyCount)
+{
+    vector<thread> workers;
+    static int data = 0;
+
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int t = 0; t < threads; t++)
+    {
+        workers.push_back(thread([&tree, t, ops, keyCount]() {
+            mt19937_64 preload(42);
+            mt19937_64 rng(1000 + t);
+            vector<unsigned long long> mine;
+
+            // skip to a thread specific point of the preloaded stream
+            preload.discard((keyCount / 8) * (t % 8));
+
+            for (unsigned long long i = 0; i < ops; i++)
+            {
+                unsigned long long roll = rng() % 10;
+
+                if (roll == 0)
+                {
+                    mine.push_back(rng());
+                    tree.insert(mine.back(), &data);
+                }
+                else if (roll == 1 && !mine.empty())
+                {
+                    tree.del(mine.back());
+                    mine.pop_back();
+                }
+                else
+                    tree.contains(preload());
+            }
+
+            for (size_t i = 0; i < mine.size(); i++)
+                tree.del(mine[i]);
+        }));
+    }
+
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    double seconds = duration<double>(steady_clock::now() - start).count();
+    return (threads * ops) / seconds / 1e6;
+}
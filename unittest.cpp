@@ -1,135 +1,1633 @@
+// fork the set operations on tiny subtrees so the threaded paths are exercised by small trees
+#define PARALLEL_GRAIN 2
+
+// run every tree with its operation counters so the instrumented paths are tested as well
+#define RBT_STATS
+
 #include "rbt.h"
+#include "shardedrbt.h"
+#include "persistentrbt.h"
+#include "compactrbt.h"
+#include "frozenrbt.h"
 #include <time.h>
+#include <thread>
+#include <memory>
+#include <string>
+#include <random>
+#include <set>
 #include <vector>
 #include <chrono>
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <iomanip>
 #include <stdlib.h>
 #include <iostream>
 
-using namespace std;
-using namespace chrono;
+using namespace std;
+using namespace chrono;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+////                                              UNIT TESTING SUITE                                         ////
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+template <class N>
+bool isBlack(N*);
+
+template <class N>
+bool allRedOrBlack(N*, N*);
+
+template <class Tree>
+void performRedBlackPropertyAssertion(Tree*);
+
+template <class N>
+bool redHasBlackChildren(N*, N*);
+
+void logStatus(unsigned long long*, unsigned long long*, string);
+
+void allocatorUnitTest();
+
+void iteratorUnitTest();
+
+void orderStatisticUnitTest();
+
+void bulkBuildUnitTest();
+
+void setOperationsUnitTest();
+
+void shardedUnitTest();
+
+void persistentUnitTest();
+
+template <class T>
+int checkPersistent(const rbPersistentNode<T>*);
+
+void compactUnitTest();
+
+void genericUnitTest();
+
+void frozenUnitTest();
+
+void imageUnitTest();
+
+void statsUnitTest();
+
+void batchUnitTest();
+
+void hintedUnitTest();
+
+void queueUnitTest();
+
+void intervalUnitTest();
+
+void eraseUnitTest();
+
+template <class T>
+int checkCompact(CompactRBT<T>&, uint32_t);
+
+template <class Tree>
+void assertTreeHolds(Tree&, vector<unsigned long long>&);
+
+template <class Tree>
+void assertIntervalQueries(Tree&, vector<pair<long long, long long>>&, mt19937_64&);
+
+template <class N>
+size_t checkSubtreeSizes(N*, N*);
+
+template <class N>
+bool allSimplePathsHaveSameBlackNodeCount(N*, N*);
+
+template <class N>
+void getSimplePathBlackCounts(N*, N*, vector<int>&, int = 0, int = 0);
+
+/**
+ * Main controller for testing the RBT class implementation.
+ * 
+ * @param int
+ * @param char**
+ * @return int
+ */
+int main(int argc, char** argv)
+{
+    int lastLog = 0;
+    srand(time(NULL));  // Initialize random seed
+    milliseconds elapsed, end;
+    RBT<bool> tree = RBT<bool>();
+    
+    unsigned long long nodeGenCount = rand() % (SHRT_MAX / 2) + (SHRT_MAX / 4); //  (32,767 / 4) - (32,767 / 2)
+    unsigned long long *keysInTree = new unsigned long long[nodeGenCount];
+    
+    cout << nodeGenCount << " nodes will be generated for red black tree unit tests." << endl;
+    cout << "Insertion unit test now being performed." << endl;
+
+    milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+
+    // Create red black tree nodes & insert into tree
+    for (int i = 0; i < nodeGenCount; i++)
+    {
+        unsigned long long randomKey = rand() % ULLONG_MAX + 1; // 1 - 18,446,744,073,709,551,615
+        bool randomData = rand() % 1; // 0 or 1
+        tree.insert(randomKey, &randomData);
+
+        end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        elapsed = end - start;
+        double elMilli = duration<double>(elapsed).count();
+        int elTime = (int) elMilli; 
+        
+        if (lastLog != elTime && elTime % 3 == 0)
+        {
+            unsigned long long tmp = i;
+            logStatus(&tmp, &nodeGenCount, "insertion");
+            lastLog = elTime;
+        }
+
+        // Perform assertion that properties hold after insertion
+        performRedBlackPropertyAssertion(&tree);
+        keysInTree[i] = randomKey;
+    }
+    
+    lastLog = 0;
+    unsigned long long keyIter = 0;
+
+    cout << "Deletion unit test now being performed." << endl;
+    
+    while (!tree.isEmpty())
+    {
+        unsigned long long removeKey = keysInTree[keyIter];
+        
+        tree.del(removeKey);
+
+        // perform assertino that properties hold after deletion
+        if (!tree.isEmpty())
+            performRedBlackPropertyAssertion(&tree);
+
+        end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+        elapsed = end - start;
+        double elMilli = duration<double>(elapsed).count();
+        int elTime = (int) elMilli;
+        
+        if (lastLog != elTime && elTime % 3 == 0)
+        {
+            logStatus(&keyIter, &nodeGenCount, "deletion");
+            lastLog = elTime;
+        }
+        
+        keyIter++;
+    }
+
+    logStatus(&keyIter, &nodeGenCount, "deletion");
+    
+    end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+    elapsed = end - start;
+    double elFinal = duration<double>(elapsed).count();
+    
+    cout << "Total completion time took about " << elFinal << " seconds." << endl;
+    
+    delete [] keysInTree;
+
+    allocatorUnitTest();
+    iteratorUnitTest();
+    orderStatisticUnitTest();
+    bulkBuildUnitTest();
+    setOperationsUnitTest();
+    shardedUnitTest();
+    persistentUnitTest();
+    compactUnitTest();
+    genericUnitTest();
+    frozenUnitTest();
+    imageUnitTest();
+    statsUnitTest();
+    batchUnitTest();
+    hintedUnitTest();
+    queueUnitTest();
+    intervalUnitTest();
+    eraseUnitTest();
+    
+    return 0;
+}
+
+/**
+ * Exercises both node allocation policies by filling a tree, churning part of it so freed nodes are reused,
+ * clearing it and then refilling the same tree.
+ * 
+ * @return void
+ */
+void allocatorUnitTest()
+{
+    cout << "Allocator unit test now being performed." << endl;
+
+    bool data = true;
+    RBT<bool> pooled;
+    RBT<bool, rbHeapAllocator> heap;
+
+    pooled.reserve(1000);
+    assert(pooled.getRoot() == pooled.getSentinel());
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (unsigned long long i = 0; i < 1000; i++)
+        {
+            pooled.insert((i * 7919) % 1000, &data);
+            heap.insert((i * 7919) % 1000, &data);
+        }
+
+        for (unsigned long long i = 0; i < 1000; i += 2)
+        {
+            assert(true == pooled.del(i));
+            assert(true == heap.del(i));
+        }
+
+        for (unsigned long long i = 0; i < 1000; i += 2)
+            pooled.insert(i, &data);
+
+        performRedBlackPropertyAssertion(&pooled);
+        performRedBlackPropertyAssertion(&heap);
+        assert(pooled.search(998) != pooled.getSentinel());
+        assert(heap.search(998) == heap.getSentinel());
+
+        pooled.clear();
+        heap.clear();
+        assert(pooled.isEmpty() && heap.isEmpty());
+        assert(pooled.search(1) == pooled.getSentinel());
+    }
+
+    cout << "Allocator unit test has been completed." << endl;
+}
+
+/**
+ * Validates in order iteration in both directions as well as lower_bound, upper_bound, find and forEachInRange
+ * against a sorted vector holding the same keys, duplicates included.
+ * 
+ * @return void
+ */
+void iteratorUnitTest()
+{
+    cout << "Iterator unit test now being performed." << endl;
+
+    bool data = true;
+    RBT<bool> tree;
+    vector<unsigned long long> keys;
+
+    assert(tree.begin() == tree.end());
+
+    for (int i = 0; i < 2000; i++)
+    {
+        unsigned long long key = rand() % 1500;
+        tree.insert(key, &data);
+        keys.push_back(key);
+    }
+    sort(keys.begin(), keys.end());
+
+    size_t idx = 0;
+    for (RBT<bool>::iterator it = tree.begin(); it != tree.end(); ++it)
+        assert(it->key == keys[idx++]);
+    assert(idx == keys.size());
+
+    RBT<bool>::iterator back = tree.end();
+    while (idx > 0)
+        assert((--back)->key == keys[--idx]);
+    assert(back == tree.begin());
+
+    for (unsigned long long key = 0; key <= 1500; key++)
+    {
+        size_t lower = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        size_t upper = std::upper_bound(keys.begin(), keys.end(), key) - keys.begin();
+
+        RBT<bool>::iterator lb = tree.lower_bound(key);
+        RBT<bool>::iterator ub = tree.upper_bound(key);
+        assert(lower == keys.size() ? lb == tree.end() : lb->key == keys[lower]);
+        assert(upper == keys.size() ? ub == tree.end() : ub->key == keys[upper]);
+        assert((lower != upper) == (tree.find(key) != tree.end()));
+
+        // every duplicate is reachable by walking forward from find
+        size_t dups = 0;
+        for (RBT<bool>::iterator it = tree.find(key); it != tree.end() && it->key == key; ++it)
+            dups++;
+        assert(dups == upper - lower);
+
+        size_t visited = 0;
+        tree.forEachInRange(key, key + 100, [&](rbNode<bool>* n) {
+            assert(n->key >= key && n->key < key + 100);
+            visited++;
+        });
+        size_t inRange = std::lower_bound(keys.begin(), keys.end(), key + 100) - keys.begin() - lower;
+        assert(visited == inRange);
+    }
+
+    cout << "Iterator unit test has been completed." << endl;
+}
+
+/**
+ * Runs a random sequence of insertions and deletions on an order statistic tree, validating the subtree sizes and
+ * red black properties along the way and comparing select, rank and countRange against a sorted vector.
+ * 
+ * @return void
+ */
+void orderStatisticUnitTest()
+{
+    cout << "Order statistic unit test now being performed." << endl;
+
+    bool data = true;
+    OrderStatisticRBT<bool> tree;
+    vector<unsigned long long> keys;
+
+    assert(tree.select(1) == tree.getSentinel());
+    assert(tree.rank(10) == 0 && tree.countRange(0, 10) == 0);
+
+    for (int step = 0; step < 6000; step++)
+    {
+        if (keys.empty() || rand() % 3 != 0)
+        {
+            unsigned long long key = rand() % 2000;
+            tree.insert(key, &data);
+            keys.insert(std::upper_bound(keys.begin(), keys.end(), key), key);
+        }
+        else
+        {
+            unsigned long long key = keys[rand() % keys.size()];
+            assert(true == tree.del(key));
+            keys.erase(std::lower_bound(keys.begin(), keys.end(), key));
+        }
+
+        assert(checkSubtreeSizes(tree.getRoot(), tree.getSentinel()) == keys.size());
+
+        if (step % 500 == 0)
+            performRedBlackPropertyAssertion(&tree);
+    }
+
+    for (size_t k = 1; k <= keys.size(); k++)
+        assert(tree.select(k)->key == keys[k - 1]);
+    assert(tree.select(keys.size() + 1) == tree.getSentinel());
+
+    for (unsigned long long key = 0; key <= 2000; key += 7)
+    {
+        size_t below = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+        size_t upTo = std::upper_bound(keys.begin(), keys.end(), key + 50) - keys.begin();
+        assert(tree.rank(key) == below);
+        assert(tree.countRange(key, key + 50) == upTo - below);
+    }
+
+    cout << "Order statistic unit test has been completed." << endl;
+}
+
+/**
+ * Builds trees of every size up to a few hundred from sorted input and checks the red black properties hold
+ * without any fixups, then merges both small and large unsorted batches into existing trees and compares the
+ * result against a sorted vector.
+ * 
+ * @return void
+ */
+void bulkBuildUnitTest()
+{
+    cout << "Bulk build unit test now being performed." << endl;
+
+    bool data = true;
+    vector<pair<unsigned long long, bool*>> sorted;
+
+    for (unsigned long long n = 0; n <= 300; n++)
+    {
+        OrderStatisticRBT<bool> tree(sorted.begin(), sorted.end());
+
+        assert(tree.size() == n);
+        assert(checkSubtreeSizes(tree.getRoot(), tree.getSentinel()) == n);
+        if (n > 0)
+            performRedBlackPropertyAssertion(&tree);
+
+        unsigned long long expected = 0;
+        for (OrderStatisticRBT<bool>::iterator it = tree.begin(); it != tree.end(); ++it)
+            assert(it->key == 2 * expected++);
+        assert(expected == n);
+
+        // the built tree must keep working under ordinary updates
+        tree.insert(n, &data);
+        tree.del(0);
+        assert(checkSubtreeSizes(tree.getRoot(), tree.getSentinel()) == n);
+        if (n > 0)
+            performRedBlackPropertyAssertion(&tree);
+
+        sorted.push_back(make_pair(2 * n, &data));
+    }
+
+    size_t batchSizes[] = {5, 50, 5000};
+    for (size_t b = 0; b < 3; b++)
+    {
+        RBT<bool> tree;
+        vector<unsigned long long> keys;
+        vector<pair<unsigned long long, bool*>> batch;
+
+        for (int i = 0; i < 1000; i++)
+        {
+            unsigned long long key = rand() % 10000;
+            tree.insert(key, &data);
+            keys.push_back(key);
+        }
+        rbNode<bool>* kept = tree.search(keys[0]);
+
+        for (size_t i = 0; i < batchSizes[b]; i++)
+        {
+            unsigned long long key = rand() % 10000;
+            batch.push_back(make_pair(key, &data));
+            keys.push_back(key);
+        }
+        tree.insertBatch(batch.begin(), batch.end());
+        sort(keys.begin(), keys.end());
+
+        assert(tree.size() == keys.size());
+        assert(tree.search(kept->key) != tree.getSentinel());
+        performRedBlackPropertyAssertion(&tree);
+
+        size_t idx = 0;
+        for (RBT<bool>::iterator it = tree.begin(); it != tree.end(); ++it)
+            assert(it->key == keys[idx++]);
+        assert(idx == keys.size());
+    }
+
+    cout << "Bulk build unit test has been completed." << endl;
+}
+
+/**
+ * Checks split, join, unionWith, intersectWith and differenceWith on random trees with duplicate keys against the
+ * same operations performed on sorted vectors. Every tree is allowed to fork so the threaded recursion is covered.
+ * 
+ * @return void
+ */
+void setOperationsUnitTest()
+{
+    cout << "Set operations unit test now being performed." << endl;
+
+    bool data = true;
+
+    for (int round = 0; round < 20; round++)
+    {
+        OrderStatisticRBT<bool> a, b, c;
+        vector<unsigned long long> keysA, keysB;
+        size_t sizeA = rand() % 3000, sizeB = rand() % 3000;
+
+        a.setParallelism(4);
+        c.setParallelism(4);
+
+        for (size_t i = 0; i < sizeA; i++)
+        {
+            keysA.push_back(rand() % 4000);
+            a.insert(keysA.back(), &data);
+            c.insert(keysA.back(), &data);
+        }
+        for (size_t i = 0; i < sizeB; i++)
+        {
+            keysB.push_back(rand() % 4000);
+            b.insert(keysB.back(), &data);
+        }
+        sort(keysA.begin(), keysA.end());
+        sort(keysB.begin(), keysB.end());
+
+        // keep only the keys of c which are (or are not) present in b
+        vector<unsigned long long> common, remaining;
+        for (size_t i = 0; i < keysA.size(); i++)
+        {
+            if (binary_search(keysB.begin(), keysB.end(), keysA[i]))
+                common.push_back(keysA[i]);
+            else
+                remaining.push_back(keysA[i]);
+        }
+
+        if (round % 2 == 0)
+        {
+            c.intersectWith(b);
+            assertTreeHolds(c, common);
+        }
+        else
+        {
+            c.differenceWith(b);
+            assertTreeHolds(c, remaining);
+        }
+        assert(b.size() == keysB.size());
+
+        // split around a random key and join back, the second join overlaps and falls back to a union
+        unsigned long long pivot = rand() % 4000;
+        OrderStatisticRBT<bool> right;
+        a.split(pivot, right);
+
+        vector<unsigned long long> lower(keysA.begin(), std::lower_bound(keysA.begin(), keysA.end(), pivot));
+        vector<unsigned long long> upper(std::lower_bound(keysA.begin(), keysA.end(), pivot), keysA.end());
+        assertTreeHolds(a, lower);
+        assertTreeHolds(right, upper);
+
+        right.insert(pivot, &data);
+        upper.insert(std::lower_bound(upper.begin(), upper.end(), pivot), pivot);
+        lower.insert(lower.end(), upper.begin(), upper.end());
+        keysA = lower;
+
+        a.join(right);
+        assertTreeHolds(a, keysA);
+        assert(right.isEmpty());
+
+        a.unionWith(b);
+        keysA.insert(keysA.end(), keysB.begin(), keysB.end());
+        sort(keysA.begin(), keysA.end());
+        assertTreeHolds(a, keysA);
+        assert(b.isEmpty());
+
+        // the adopted and shared nodes must keep working once the other trees are gone
+        b.insert(1, &data);
+        a.insert(2, &data);
+        keysA.insert(std::lower_bound(keysA.begin(), keysA.end(), 2), 2);
+        assertTreeHolds(a, keysA);
+    }
+
+    cout << "Set operations unit test has been completed." << endl;
+}
+
+/**
+ * Has several threads insert and delete interleaved keys on sharded trees, one split evenly and one split at
+ * custom bounds, and then checks ordered iteration and range scans across shard boundaries.
+ * 
+ * @return void
+ */
+void shardedUnitTest()
+{
+    cout << "Sharded tree unit test now being performed." << endl;
+
+    static bool data = true;
+    vector<unsigned long long> bounds;
+    bounds.push_back(1000);
+    bounds.push_back(5000);
+    bounds.push_back(5001);
+
+    ShardedRBT<bool> even(7);
+    ShardedRBT<bool> custom(bounds);
+    assert(even.shardCount() == 7 && custom.shardCount() == 4);
+
+    const unsigned long long perThread = 3000;
+    const unsigned long long stride = ULLONG_MAX / (4 * perThread);
+    vector<thread> workers;
+
+    for (unsigned long long t = 0; t < 4; t++)
+    {
+        workers.push_back(thread([&even, &custom, t, perThread, stride]() {
+            for (unsigned long long i = t; i < 4 * perThread; i += 4)
+            {
+                even.insert(i * stride, &data);
+                custom.insert(i, &data);
+            }
+            for (unsigned long long i = t; i < 4 * perThread; i += 8)
+            {
+                assert(even.del(i * stride));
+                assert(custom.del(i));
+                assert(!custom.contains(i));
+            }
+        }));
+    }
+    for (size_t t = 0; t < workers.size(); t++)
+        workers[t].join();
+
+    // keys whose index is 0, 1, 2 or 3 modulo 8 were removed
+    vector<unsigned long long> expected;
+    for (unsigned long long i = 0; i < 4 * perThread; i++)
+    {
+        if (i % 8 >= 4)
+            expected.push_back(i);
+    }
+
+    size_t idx = 0;
+    even.forEach([&](rbNode<bool>* n) { assert(n->key == expected[idx++] * stride); });
+    assert(idx == expected.size() && even.size() == expected.size());
+
+    idx = 0;
+    custom.forEach([&](rbNode<bool>* n) { assert(n->key == expected[idx++]); });
+    assert(idx == expected.size());
+
+    for (unsigned long long lo = 0; lo < 4 * perThread; lo += 997)
+    {
+        unsigned long long hi = std::min(lo + 4500, 4 * perThread);
+        size_t first = std::lower_bound(expected.begin(), expected.end(), lo) - expected.begin();
+        size_t last = std::lower_bound(expected.begin(), expected.end(), hi) - expected.begin();
+
+        idx = first;
+        custom.forEachInRange(lo, hi, [&](rbNode<bool>* n) { assert(n->key == expected[idx++]); });
+        assert(idx == last);
+
+        idx = first;
+        even.forEachInRange(lo * stride, hi * stride, [&](rbNode<bool>* n) { assert(n->key == expected[idx++] * stride); });
+        assert(idx == last);
+    }
+
+    assert(custom.search(expected[0]) == &data && custom.search(0) == nullptr);
+    custom.clear();
+    assert(custom.isEmpty());
+
+    cout << "Sharded tree unit test has been completed." << endl;
+}
+
+/**
+ * Applies random inserts, duplicate inserts and deletes to a persistent tree while keeping a snapshot and the
+ * expected keys of every tenth version, then checks that all old versions are unchanged and balanced. Finally a
+ * writer keeps updating the tree while reader threads iterate snapshots without any locking.
+ * 
+ * @return void
+ */
+void persistentUnitTest()
+{
+    cout << "Persistent tree unit test now being performed." << endl;
+
+    static bool data = true;
+    PersistentRBT<bool> tree;
+    vector<unsigned long long> keys;
+    vector<rbSnapshot<bool>> versions;
+    vector<vector<unsigned long long>> expected;
+    srand(7);
+
+    for (int i = 0; i < 6000; i++)
+    {
+        unsigned long long key = rand() % 2000;
+        vector<unsigned long long>::iterator pos = std::lower_bound(keys.begin(), keys.end(), key);
+
+        if (rand() % 3 == 0)
+        {
+            bool present = pos != keys.end() && *pos == key;
+            assert(tree.del(key) == present);
+            if (present)
+                keys.erase(pos);
+        }
+        else
+        {
+            tree.insert(key, &data);
+            keys.insert(pos, key);
+        }
+
+        if (i % 10 == 0)
+        {
+            versions.push_back(tree.snapshot());
+            expected.push_back(keys);
+        }
+    }
+
+    assert(tree.size() == keys.size() && tree.search(keys[0]) == &data && !tree.contains(5000));
+
+    for (size_t v = 0; v < versions.size(); v++)
+    {
+        size_t idx = 0;
+        for (rbSnapshot<bool>::iterator it = versions[v].begin(); it != versions[v].end(); ++it)
+            assert(it->key == expected[v][idx++]);
+        assert(idx == expected[v].size() && versions[v].size() == idx);
+
+        if (!versions[v].isEmpty())
+        {
+            assert(versions[v].getRoot()->rbColor == BLACK);
+            assert(checkPersistent(versions[v].getRoot()) > 0);
+        }
+    }
+
+    // half-open range scan and lower_bound on the latest version
+    rbSnapshot<bool> latest = tree.snapshot();
+    size_t first = std::lower_bound(keys.begin(), keys.end(), 500) - keys.begin();
+    size_t last = std::lower_bound(keys.begin(), keys.end(), 1500) - keys.begin();
+    size_t idx = first;
+    latest.forEachInRange(500, 1500, [&](const rbPersistentNode<bool>* n) { assert(n->key == keys[idx++]); });
+    assert(idx == last);
+    assert(latest.find(2500) == latest.end() && latest.find(keys[first])->key == keys[first]);
+
+    // readers walk whatever version is current while the writer drains the tree
+    vector<thread> readers;
+    for (int t = 0; t < 3; t++)
+    {
+        readers.push_back(thread([&tree]() {
+            for (int round = 0; round < 200; round++)
+            {
+                rbSnapshot<bool> view = tree.snapshot();
+                size_t seen = 0;
+                unsigned long long previous = 0;
+
+                for (rbSnapshot<bool>::iterator it = view.begin(); it != view.end(); ++it, seen++)
+                {
+                    assert(it->key >= previous);
+                    previous = it->key;
+                }
+                assert(seen == view.size());
+            }
+        }));
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+        assert(tree.del(keys[i]));
+    for (size_t t = 0; t < readers.size(); t++)
+        readers[t].join();
+
+    assert(tree.isEmpty() && latest.size() == keys.size());
+    tree.insert(1, &data);
+    tree.clear();
+    assert(tree.isEmpty() && tree.snapshot().begin() == tree.snapshot().end());
+
+    cout << "Persistent tree unit test has been completed." << endl;
+}
+
+/**
+ * Checks the red black properties below a persistent node and returns the black height of the subtree, or -1 if
+ * a red node has a red child or two paths disagree on their black node count.
+ * 
+ * @param const rbPersistentNode<T>*
+ * @return int
+ */
+template <class T>
+int checkPersistent(const rbPersistentNode<T>* n)
+{
+    if (n == nullptr)
+        return 1;
+
+    const rbPersistentNode<T>* left = n->left.get();
+    const rbPersistentNode<T>* right = n->right.get();
+
+    if (n->rbColor == RED && ((left != nullptr && left->rbColor == RED) || (right != nullptr && right->rbColor == RED)))
+        return -1;
+
+    int lh = checkPersistent(left);
+    int rh = checkPersistent(right);
+
+    if (lh < 0 || lh != rh)
+        return -1;
+    return lh + (n->rbColor == BLACK ? 1 : 0);
+}
+
+/**
+ * Runs the same random mix of inserts, duplicate inserts and deletes on a CompactRBT and a sorted vector,
+ * checking the red black properties and the contents of the tree as it goes, and checks the packed node size.
+ * 
+ * @return void
+ */
+void compactUnitTest()
+{
+    cout << "Compact tree unit test now being performed." << endl;
+
+    static_assert(sizeof(rbCompactNode<bool>) == 24, "compact nodes should take 24 bytes");
+
+    static bool data = true;
+    CompactRBT<bool> tree;
+    vector<unsigned long long> keys;
+    srand(11);
+
+    for (int i = 0; i < 20000; i++)
+    {
+        unsigned long long key = rand() % 5000;
+        vector<unsigned long long>::iterator pos = std::lower_bound(keys.begin(), keys.end(), key);
+
+        if (rand() % 3 == 0)
+        {
+            bool present = pos != keys.end() && *pos == key;
+            assert(tree.del(key) == present);
+            assert(tree.contains(key) == (present && pos + 1 != keys.end() && *(pos + 1) == key));
+            if (present)
+                keys.erase(pos);
+        }
+        else
+        {
+            tree.insert(key, &data);
+            keys.insert(pos, key);
+            assert(tree.search(key) == &data);
+        }
+
+        if (i % 500 == 0 && !tree.isEmpty())
+        {
+            assert(tree.getNode(tree.getRoot()).rbColor() == BLACK);
+            assert(checkCompact(tree, tree.getRoot()) > 0);
+        }
+    }
+
+    size_t idx = 0;
+    tree.forEach([&](const rbCompactNode<bool>* n) { assert(n->key == keys[idx++]); });
+    assert(idx == keys.size() && tree.size() == keys.size());
+
+    size_t first = std::lower_bound(keys.begin(), keys.end(), 1000) - keys.begin();
+    size_t last = std::lower_bound(keys.begin(), keys.end(), 3000) - keys.begin();
+    idx = first;
+    tree.forEachInRange(1000, 3000, [&](const rbCompactNode<bool>* n) { assert(n->key == keys[idx++]); });
+    assert(idx == last);
+
+    // drain the tree in random order, freed slots have to be reused when it is refilled
+    shuffle(keys.begin(), keys.end(), mt19937(11));
+    for (size_t i = 0; i < keys.size(); i++)
+        assert(tree.del(keys[i]));
+    assert(tree.isEmpty() && !tree.del(keys[0]));
+
+    size_t bytes = tree.memoryUsage();
+    for (size_t i = 0; i < keys.size(); i++)
+        tree.insert(keys[i], &data);
+    assert(tree.memoryUsage() == bytes && checkCompact(tree, tree.getRoot()) > 0);
+
+    tree.clear();
+    assert(tree.isEmpty() && tree.getRoot() == 0);
+
+    cout << "Compact tree unit test has been completed." << endl;
+}
+
+/**
+ * Checks the red black properties and the key order below the compact node at index n and returns the black
+ * height of the subtree, or -1 if any of them is violated.
+ * 
+ * @param CompactRBT<T>&
+ * @param uint32_t
+ * @return int
+ */
+template <class T>
+int checkCompact(CompactRBT<T>& tree, uint32_t n)
+{
+    if (n == 0)
+        return 1;
+
+    const rbCompactNode<T>& node = tree.getNode(n);
+    uint32_t left = node.left();
+    uint32_t right = node.right();
+
+    if (node.rbColor() == RED && ((left != 0 && tree.getNode(left).rbColor() == RED) ||
+                                  (right != 0 && tree.getNode(right).rbColor() == RED)))
+        return -1;
+
+    if ((left != 0 && tree.getNode(left).key > node.key) || (right != 0 && tree.getNode(right).key < node.key))
+        return -1;
+
+    int lh = checkCompact(tree, left);
+    int rh = checkCompact(tree, right);
+
+    if (lh < 0 || lh != rh)
+        return -1;
+    return lh + (node.rbColor() == BLACK ? 1 : 0);
+}
+
+/**
+ * Move only value which counts how many instances are alive, so the test can tell that every value stored in a
+ * tree is destroyed exactly once.
+ */
+struct liveValue
+{
+    static int alive;
+    std::unique_ptr<int> payload;
+
+    liveValue() { alive++; }
+    liveValue(int v) : payload(new int(v)) { alive++; }
+    liveValue(liveValue&& other) : payload(std::move(other.payload)) { alive++; }
+    liveValue& operator=(liveValue&& other) { payload = std::move(other.payload); return *this; }
+    ~liveValue() { alive--; }
+};
+
+int liveValue::alive = 0;
+
+/**
+ * Exercises a tree with string keys in descending order and move only values stored inline: emplace, try_emplace,
+ * insert_or_assign, deletion, bulk building from moved pairs and the set operations, checking after each step that
+ * no value was leaked or destroyed twice.
+ * 
+ * @return void
+ */
+void genericUnitTest()
+{
+    cout << "Generic key and inline value unit test now being performed." << endl;
+
+    typedef RBTree<string, liveValue, std::greater<string>> Tree;
+
+    {
+        Tree tree;
+
+        for (int i = 0; i < 500; i++)
+            tree.emplace(to_string(i), i);
+        // every tree also owns one default constructed value in its sentinel
+        assert(tree.size() == 500 && liveValue::alive == 501);
+
+        // descending string order
+        string previous = "~";
+        for (Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+        {
+            assert(it->key < previous && *it->data.payload == stoi(it->key));
+            previous = it->key;
+        }
+        performRedBlackPropertyAssertion(&tree);
+
+        std::pair<Tree::iterator, bool> r = tree.try_emplace("42", 0);
+        assert(!r.second && *r.first->data.payload == 42 && liveValue::alive == 501);
+        r = tree.try_emplace("1000", 1000);
+        assert(r.second && *r.first->data.payload == 1000);
+
+        r = tree.insert_or_assign("42", liveValue(-42));
+        assert(!r.second && *tree.find("42")->data.payload == -42);
+        r = tree.insert_or_assign("zz", liveValue(7));
+        assert(r.second && tree.size() == 502 && liveValue::alive == 503);
+
+        for (int i = 0; i < 500; i += 2)
+            assert(tree.del(to_string(i)));
+        assert(!tree.del("0") && tree.size() == 252 && liveValue::alive == 253);
+        performRedBlackPropertyAssertion(&tree);
+
+        tree.insert("x", liveValue(1));
+        assert(tree.search("x")->data.payload != nullptr && tree.lower_bound("y")->key == "x");
+
+        vector<pair<string, liveValue>> sorted;
+        for (int i = 999; i >= 500; i--)
+            sorted.push_back(make_pair(to_string(i), liveValue(i)));
+        std::sort(sorted.begin(), sorted.end(), [](const pair<string, liveValue>& a, const pair<string, liveValue>& b) {
+            return a.first > b.first;
+        });
+
+        Tree other(make_move_iterator(sorted.begin()), make_move_iterator(sorted.end()));
+        sorted.clear();
+        assert(other.size() == 500 && *other.find("777")->data.payload == 777);
+
+        // the odd keys below 500 are in both trees, drop them from other and merge the rest
+        Tree odd;
+        for (int i = 1; i < 500; i += 2)
+            odd.emplace(to_string(i), i);
+        other.unionWith(odd);
+        other.differenceWith(tree);
+        assert(odd.isEmpty() && other.size() == 500 && liveValue::alive == 253 + 500 + 3);
+
+        tree.unionWith(other);
+        assert(tree.size() == 753 && other.isEmpty() && liveValue::alive == 756);
+        performRedBlackPropertyAssertion(&tree);
+
+        Tree low;
+        tree.split("5", low);
+        assert(tree.size() + low.size() == 753 && liveValue::alive == 757);
+        tree.clear();
+        assert(liveValue::alive == 4 + (int) low.size());
+    }
+
+    assert(liveValue::alive == 0);
+
+    cout << "Generic key and inline value unit test has been completed." << endl;
+}
+
+/**
+ * Freezes trees of sizes around the block and level boundaries, with many duplicate keys, and checks iteration,
+ * find, lower_bound, upper_bound and range scans of the frozen copy against the tree it was made from. A tree with
+ * string keys in descending order exercises the portable block comparison.
+ * 
+ * @return void
+ */
+void frozenUnitTest()
+{
+    cout << "Frozen tree unit test now being performed." << endl;
+
+    mt19937_64 gen(17);
+    size_t sizes[] = {0, 1, 7, 8, 9, 72, 73, 81, 648, 5000, 100000};
+
+    for (size_t n : sizes)
+    {
+        RBTree<unsigned long long, unsigned long long> tree;
+        for (size_t i = 0; i < n; i++)
+        {
+            unsigned long long key = gen() % (n * 2 + 1);
+            tree.insert(key, key * 3);
+        }
+
+        FrozenRBT<unsigned long long, unsigned long long> frozen = tree.freeze();
+        assert(frozen.size() == n && frozen.isEmpty() == (n == 0));
+
+        vector<unsigned long long> sorted;
+        FrozenRBT<unsigned long long, unsigned long long>::iterator fit = frozen.begin();
+        for (RBTree<unsigned long long, unsigned long long>::iterator it = tree.begin(); it != tree.end(); ++it, ++fit)
+        {
+            assert(fit.position() == sorted.size() && fit.key() == it->key && fit.data() == it->data);
+            sorted.push_back(it->key);
+        }
+        assert(fit == frozen.end());
+
+        for (unsigned long long probe = 0; probe <= n * 2 + 2; probe++)
+        {
+            size_t below = std::lower_bound(sorted.begin(), sorted.end(), probe) - sorted.begin();
+            size_t notAbove = std::upper_bound(sorted.begin(), sorted.end(), probe) - sorted.begin();
+
+            assert(frozen.lower_bound(probe).position() == below);
+            assert(frozen.upper_bound(probe).position() == notAbove);
+            assert(frozen.contains(probe) == (below != notAbove));
+            assert((frozen.find(probe) == frozen.end()) == (below == notAbove));
+            assert(frozen.search(probe) == nullptr || *frozen.search(probe) == probe * 3);
+        }
+        assert(frozen.lower_bound(ULLONG_MAX) == frozen.end());
+
+        unsigned long long lo = n / 3, hi = n + n / 2;
+        vector<unsigned long long> expected, seen;
+        tree.forEachInRange(lo, hi, [&](RBTree<unsigned long long, unsigned long long>::node* node) {
+            expected.push_back(node->key);
+        });
+        frozen.forEachInRange(lo, hi, [&](const unsigned long long& key, const unsigned long long& data) {
+            assert(data == key * 3);
+            seen.push_back(key);
+        });
+        assert(seen == expected);
+    }
+
+    RBTree<string, int, std::greater<string>> words;
+    for (int i = 0; i < 1000; i++)
+        words.insert(to_string(i), i);
+
+    FrozenRBT<string, int, std::greater<string>> frozenWords = words.freeze();
+    assert(frozenWords.size() == 1000 && frozenWords.begin().key() == "999");
+    assert(*frozenWords.search("500") == 500 && frozenWords.search("5000") == nullptr);
+    assert(frozenWords.lower_bound("5000").key() == "500" && frozenWords.upper_bound("0") == frozenWords.end());
+
+    cout << "Frozen tree unit test has been completed." << endl;
+}
+
+/**
+ * Saves trees to binary images and loads them back, once with values copied byte for byte and once through a
+ * serializer, and checks that empty trees round trip, that corrupt, missing or mismatched images are rejected without
+ * touching the tree they were loaded into, and that a save to a directory which does not exist fails.
+ * 
+ * @return void
+ */
+void imageUnitTest()
+{
+    cout << "Binary image unit test now being performed." << endl;
+
+    const string path = "rbt_image_test.bin";
+    typedef RBTree<unsigned long long, unsigned long long> Tree;
+
+    mt19937_64 gen(23);
+    Tree tree, loaded;
+
+    assert(tree.save(path) && loaded.load(path) && loaded.isEmpty());
 
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-////                                              UNIT TESTING SUITE                                         ////
-/////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    for (int i = 0; i < 50000; i++)
+    {
+        unsigned long long key = gen() % 40000;
+        tree.insert(key, key + 1);
+    }
 
-template <class T>
-bool isBlack(rbNode<T>*);
+    assert(tree.save(path) && loaded.load(path) && loaded.size() == tree.size());
+    performRedBlackPropertyAssertion(&loaded);
 
-template <class T>
-bool allRedOrBlack(rbNode<T>*, rbNode<T>*);
+    Tree::iterator other = loaded.begin();
+    for (Tree::iterator it = tree.begin(); it != tree.end(); ++it, ++other)
+        assert(it->key == other->key && it->data == other->data);
 
-template <class T>
-void performRedBlackPropertyAssertion(RBT<T>*);
+    // the loaded tree is an ordinary tree
+    loaded.insert(7, 8);
+    assert(loaded.del(7) && loaded.size() == tree.size());
 
-template <class T>
-bool redHasBlackChildren(rbNode<T>*, rbNode<T>*);
+    // wrong value type, missing file, flipped byte in the body
+    RBTree<unsigned long long, unsigned> narrow;
+    narrow.insert(3, 4);
+    assert(!narrow.load(path) && narrow.size() == 1 && narrow.search(3)->data == 4);
+    assert(!loaded.load("rbt_image_missing.bin") && loaded.size() == tree.size());
+    assert(!tree.save("rbt_image_missing_dir/image.bin") && !tree.save("rbt_image_missing_dir/image.bin",
+        [](const unsigned long long& value, string& out) { out.append((const char*) &value, sizeof(value)); }));
 
-void logStatus(unsigned long long*, unsigned long long*, string);
+    FILE* file = fopen(path.c_str(), "r+b");
+    fseek(file, sizeof(rbImageHeader) + 1000, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, sizeof(rbImageHeader) + 1000, SEEK_SET);
+    fputc(byte ^ 0x10, file);
+    fclose(file);
+    assert(!loaded.load(path) && loaded.size() == tree.size());
+    performRedBlackPropertyAssertion(&loaded);
 
-template <class T>
-bool allSimplePathsHaveSameBlackNodeCount(rbNode<T>*, rbNode<T>*);
+    RBTree<unsigned long long, string> words, restored;
+    for (unsigned long long i = 0; i < 3000; i++)
+        words.insert(i * 7 % 3001, string(i % 50, 'a' + i % 26));
 
-template <class T>
-void getSimplePathBlackCounts(rbNode<T>*, rbNode<T>*, vector<int>&, int = 0, int = 0);
+    assert(words.save(path, [](const string& value, string& out) { out += value; }));
+    assert(restored.load(path, [](const char* bytes, size_t length) { return string(bytes, length); }));
+    assert(restored.size() == words.size());
+    performRedBlackPropertyAssertion(&restored);
+
+    RBTree<unsigned long long, string>::iterator word = restored.begin();
+    for (RBTree<unsigned long long, string>::iterator it = words.begin(); it != words.end(); ++it, ++word)
+        assert(it->key == word->key && it->data == word->data);
+
+    assert(!restored.load("rbt_image_missing.bin", [](const char* bytes, size_t length) {
+        return string(bytes, length); }) && restored.size() == words.size());
+
+    // a valid image whose keys are out of order is only noticed while the nodes are built, which are dropped again
+    rbImageWriter unsorted(path);
+    unsigned long long records[] = {5, 3, 50, 30};
+    unsorted.write(records, sizeof(records));
+    assert(unsorted.finish(0, sizeof(unsigned long long), sizeof(unsigned long long), 2));
+    assert(!loaded.load(path) && loaded.size() == tree.size());
+    performRedBlackPropertyAssertion(&loaded);
+
+    remove(path.c_str());
+
+    cout << "Binary image unit test has been completed." << endl;
+}
 
 /**
- * Main controller for testing the RBT class implementation.
+ * Checks the operation counters against what a known sequence of operations must produce and the shape queries
+ * against the bounds of a red black tree.
  * 
- * @param int
- * @param char**
- * @return int
+ * @return void
  */
-int main(int argc, char** argv)
+void statsUnitTest()
 {
-    int lastLog = 0;
-    srand(time(NULL));  // Initialize random seed
-    milliseconds elapsed, end;
-    RBT<bool> tree = RBT<bool>();
-    
-    unsigned long long nodeGenCount = rand() % (SHRT_MAX / 2) + (SHRT_MAX / 4); //  (32,767 / 4) - (32,767 / 2)
-    unsigned long long *keysInTree = new unsigned long long[nodeGenCount];
-    
-    cout << nodeGenCount << " nodes will be generated for red black tree unit tests." << endl;
-    cout << "Insertion unit test now being performed." << endl;
+    cout << "Statistics unit test now being performed." << endl;
 
-    milliseconds start = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
+    RBTree<unsigned long long, int> tree;
+    rbStats empty = tree.stats();
+    assert(empty.counting && empty.nodeCount == 0 && empty.height == 0 && empty.averageDepth == 0);
 
-    // Create red black tree nodes & insert into tree
-    for (int i = 0; i < nodeGenCount; i++)
+    // ascending inserts only ever take case 1 or case 3 on the right side
+    for (unsigned long long i = 0; i < 1000; i++)
+        tree.insert(i, 0);
+
+    rbStats s = tree.stats();
+    assert(s.insertFixups == 1000 && s.insertCases[1] == 0 && s.insertCases[2] > 0);
+    assert(s.leftRotations == s.insertCases[2] && s.rightRotations == 0);
+    assert(s.nodeCount == 1000 && s.height >= 10 && s.height <= 2 * 10);
+    assert(s.blackHeight >= s.height / 2 && s.averageDepth >= 1 && s.averageDepth <= s.height);
+
+    for (unsigned long long i = 0; i < 1500; i++)
+        tree.search(i);
+
+    s = tree.stats();
+    unsigned long long searched = 0, deepest = 0;
+    for (int d = 0; d < RB_STATS_DEPTHS; d++)
     {
-        unsigned long long randomKey = rand() % ULLONG_MAX + 1; // 1 - 18,446,744,073,709,551,615
-        bool randomData = rand() % 1; // 0 or 1
-        tree.insert(randomKey, &randomData);
+        searched += s.searchDepths[d];
+        if (s.searchDepths[d])
+            deepest = d;
+    }
+    assert(s.searchHits == 1000 && s.searchMisses == 500 && searched == 1500 && deepest == s.height);
+    assert(s.searchDepths[1] == 1 && s.searchDepths[0] == 0);
 
-        end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-        elapsed = end - start;
-        double elMilli = duration<double>(elapsed).count();
-        int elTime = (int) elMilli; 
-        
-        if (lastLog != elTime && elTime % 3 == 0)
+    // the lookups of del are searches as well
+    for (unsigned long long i = 0; i < 1000; i += 2)
+        tree.del(i);
+
+    s = tree.stats();
+    unsigned long long cases = s.deleteCases[0] + s.deleteCases[1] + s.deleteCases[2] + s.deleteCases[3];
+    assert(s.deleteFixups > 0 && s.deleteFixups <= 500 && cases >= s.deleteCases[3] && s.nodeCount == 500);
+    assert(s.toText().find("delete fixups") != string::npos && s.toJson().front() == '{');
+    assert(s.searchHits == 1500 && s.toJson().find("\"searchHits\": 1500") != string::npos);
+
+    tree.resetStats();
+    s = tree.stats();
+    assert(s.leftRotations == 0 && s.searchHits == 0 && s.deleteFixups == 0 && s.nodeCount == 500);
+
+    // batched lookups count as one search each, with the same depths as searching the keys one at a time
+    vector<unsigned long long> keys(300);
+    for (size_t i = 0; i < keys.size(); i++)
+        keys[i] = i * 7 % 1100;
+    for (size_t i = 0; i < keys.size(); i++)
+        tree.search(keys[i]);
+    rbStats single = tree.stats();
+
+    tree.resetStats();
+    vector<RBTree<unsigned long long, int>::node*> found(keys.size());
+    tree.searchBatch(keys.data(), keys.size(), found.data());
+    s = tree.stats();
+    assert(s.searchHits + s.searchMisses == keys.size() && s.searchHits == single.searchHits);
+    assert(equal(s.searchDepths, s.searchDepths + RB_STATS_DEPTHS, single.searchDepths));
+
+    bool present[300];
+    tree.containsBatch(keys.data(), keys.size(), present);
+    assert(tree.stats().searchHits + tree.stats().searchMisses == 2 * keys.size());
+
+    cout << "Statistics unit test has been completed." << endl;
+}
+
+/**
+ * Compares searchBatch and containsBatch against one search per key, for batches smaller and larger than the
+ * number of lookups kept in flight, on a tree with duplicate keys and on an empty tree.
+ * 
+ * @return void
+ */
+void batchUnitTest()
+{
+    cout << "Batched lookup unit test now being performed." << endl;
+
+    typedef RBTree<unsigned long long, unsigned long long> Tree;
+
+    mt19937_64 gen(29);
+    Tree tree;
+    vector<unsigned long long> keys(5000);
+    vector<Tree::node*> found(keys.size());
+    bool present[5000];
+
+    tree.searchBatch(keys.data(), keys.size(), found.data());
+    assert(all_of(found.begin(), found.end(), [&](Tree::node* n) { return n == tree.getSentinel(); }));
+
+    for (int i = 0; i < 20000; i++)
+        tree.insert(gen() % 30000, i);
+
+    for (size_t i = 0; i < keys.size(); i++)
+        keys[i] = gen() % 31000;
+
+    size_t sizes[] = {0, 1, BATCH_GROUP - 1, BATCH_GROUP, BATCH_GROUP + 1, 300, keys.size()};
+    for (size_t n : sizes)
+    {
+        fill(found.begin(), found.end(), nullptr);
+        tree.searchBatch(keys.data(), n, found.data());
+        tree.containsBatch(keys.data(), n, present);
+
+        for (size_t i = 0; i < n; i++)
+            assert(found[i] == tree.search(keys[i]) && present[i] == (found[i] != tree.getSentinel()));
+        assert(n == keys.size() || found[n] == nullptr);
+    }
+
+    cout << "Batched lookup unit test has been completed." << endl;
+}
+
+/**
+ * Checks append and hinted insertion against a sorted copy of the keys: ascending and nearly ascending streams with
+ * duplicates, exact hints walking backwards, arbitrary hints, and appends after the largest node was removed or
+ * moved by del, split, join and clear. Subtree sizes are checked too, since the augmented path refresh has to
+ * follow the same links.
+ * 
+ * @return void
+ */
+void hintedUnitTest()
+{
+    cout << "Hinted insertion unit test now being performed." << endl;
+
+    typedef RBTree<unsigned long long, int, less<unsigned long long>, rbNodePool, rbOrderStatistic> Tree;
+
+    mt19937_64 gen(31);
+    Tree tree;
+    vector<unsigned long long> keys;
+
+    for (unsigned long long i = 0; i < 3000; i++)
+    {
+        Tree::iterator it = tree.append(i / 2, 0);
+        assert(it->key == i / 2);
+        keys.push_back(i / 2);
+    }
+    assertTreeHolds(tree, keys);
+
+    for (unsigned long long i = 0; i < 3000; i++)
+    {
+        unsigned long long key = 1500 + i + gen() % 16;
+        tree.append(key, 0);
+        keys.push_back(key);
+    }
+    sort(keys.begin(), keys.end());
+    assertTreeHolds(tree, keys);
+
+    // each key goes right before the previous one, so every hint is exact
+    Tree::iterator hint = tree.begin();
+    for (unsigned long long i = 0; i < 500; i++)
+    {
+        hint = tree.insert(hint, 0, 0);
+        assert(hint == tree.begin());
+        keys.insert(keys.begin(), 0);
+    }
+    assertTreeHolds(tree, keys);
+
+    for (int i = 0; i < 3000; i++)
+    {
+        unsigned long long key = gen() % 6000;
+        Tree::iterator at = gen() % 4 == 0 ? tree.end() : tree.lower_bound(gen() % 6000);
+        Tree::iterator it = tree.insert(at, key, 0);
+        assert(it->key == key);
+        keys.insert(upper_bound(keys.begin(), keys.end(), key), key);
+    }
+    assertTreeHolds(tree, keys);
+
+    for (int i = 0; i < 200; i++)
+    {
+        assert(tree.del(keys.back()));
+        keys.pop_back();
+    }
+    tree.append(keys.back() + 1, 0);
+    keys.push_back(keys.back() + 1);
+    assertTreeHolds(tree, keys);
+
+    Tree right;
+    tree.split(3000, right);
+    vector<unsigned long long> rightKeys(lower_bound(keys.begin(), keys.end(), 3000), keys.end());
+    keys.erase(lower_bound(keys.begin(), keys.end(), 3000), keys.end());
+    tree.append(2999, 0);
+    keys.push_back(2999);
+    right.append(rightKeys.back(), 0);
+    rightKeys.push_back(rightKeys.back());
+    assertTreeHolds(tree, keys);
+    assertTreeHolds(right, rightKeys);
+
+    tree.join(right);
+    keys.insert(keys.end(), rightKeys.begin(), rightKeys.end());
+    tree.append(keys.back() + 5, 0);
+    right.append(7, 0);
+    keys.push_back(keys.back() + 5);
+    rightKeys.assign(1, 7);
+    assertTreeHolds(tree, keys);
+    assertTreeHolds(right, rightKeys);
+
+    tree.clear();
+    keys.clear();
+    tree.insert(tree.end(), 9, 0);
+    tree.append(4, 0);
+    tree.insert(tree.begin(), 2, 0);
+    keys = {2, 4, 9};
+    assertTreeHolds(tree, keys);
+
+    cout << "Hinted insertion unit test has been completed." << endl;
+}
+
+/**
+ * Uses the tree as a deadline queue with many duplicate deadlines: the cached ends are compared against a walk
+ * from the root after random pushes, pops from both ends and erasures of arbitrary nodes, and every pop is checked
+ * against a multiset holding the same keys.
+ * 
+ * @return void
+ */
+void queueUnitTest()
+{
+    cout << "Priority queue unit test now being performed." << endl;
+
+    typedef RBTree<unsigned long long, int, less<unsigned long long>, rbNodePool, rbOrderStatistic> Tree;
+
+    mt19937_64 gen(37);
+    Tree tree;
+    multiset<unsigned long long> expected;
+    unsigned long long key;
+    int data;
+
+    assert(tree.peekMin() == tree.getSentinel() && tree.peekMax() == tree.getSentinel());
+    assert(!tree.popMin(key, data) && !tree.popMax(key, data) && !tree.erase(tree.getSentinel()));
+
+    for (int i = 0; i < 20000; i++)
+    {
+        int op = gen() % 8;
+
+        if (op < 4 || expected.empty())
         {
-            unsigned long long tmp = i;
-            logStatus(&tmp, &nodeGenCount, "insertion");
-            lastLog = elTime;
+            key = gen() % 500;
+            tree.insert(key, (int) key);
+            expected.insert(key);
+        }
+        else if (op == 4)
+        {
+            assert(tree.popMin(key, data) && key == *expected.begin() && data == (int) key);
+            expected.erase(expected.begin());
+        }
+        else if (op == 5)
+        {
+            assert(tree.popMax(key, data) && key == *expected.rbegin() && data == (int) key);
+            expected.erase(prev(expected.end()));
+        }
+        else
+        {
+            // erase one particular node among the duplicates of a key
+            Tree::node* n = tree.select(gen() % tree.size() + 1);
+            key = n->key;
+            assert(tree.erase(n));
+            expected.erase(expected.find(key));
         }
 
-        // Perform assertion that properties hold after insertion
-        performRedBlackPropertyAssertion(&tree);
-        keysInTree[i] = randomKey;
+        assert(tree.size() == expected.size());
+        if (tree.isEmpty())
+            assert(tree.peekMin() == tree.getSentinel() && tree.peekMax() == tree.getSentinel());
+        else
+        {
+            assert(tree.peekMin() == tree.begin().get() && tree.peekMax() == (--tree.end()).get());
+            assert(tree.min() == tree.peekMin() && tree.max() == tree.peekMax());
+        }
     }
-    
-    lastLog = 0;
-    unsigned long long keyIter = 0;
 
-    cout << "Deletion unit test now being performed." << endl;
-    
-    while (!tree.isEmpty())
+    vector<unsigned long long> keys(expected.begin(), expected.end());
+    assertTreeHolds(tree, keys);
+
+    while (tree.popMin(key, data))
     {
-        unsigned long long removeKey = keysInTree[keyIter];
-        
-        tree.del(removeKey);
+        assert(key == *expected.begin());
+        expected.erase(expected.begin());
+    }
+    assert(expected.empty() && tree.isEmpty() && tree.peekMin() == tree.getSentinel());
 
-        // perform assertino that properties hold after deletion
-        if (!tree.isEmpty())
-            performRedBlackPropertyAssertion(&tree);
+    cout << "Priority queue unit test has been completed." << endl;
+}
 
-        end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-        elapsed = end - start;
-        double elMilli = duration<double>(elapsed).count();
-        int elTime = (int) elMilli;
-        
-        if (lastLog != elTime && elTime % 3 == 0)
+/**
+ * Checks overlap and stabbing queries of an interval tree with signed end points against a scan of every interval,
+ * after random insertions and again after erasures, popMin, split and join, each of which rotates or relinks nodes
+ * and so has to keep the largest end points of the subtrees correct.
+ * 
+ * @return void
+ */
+void intervalUnitTest()
+{
+    cout << "Interval tree unit test now being performed." << endl;
+
+    typedef IntervalRBT<long long, int> Tree;
+
+    mt19937_64 gen(41);
+    Tree tree;
+    vector<pair<long long, long long>> intervals;
+
+    assertIntervalQueries(tree, intervals, gen);
+
+    for (int i = 0; i < 4000; i++)
+    {
+        long long start = (long long) (gen() % 20000) - 10000;
+        long long end = start + (long long) (gen() % (gen() % 8 == 0 ? 2000 : 50));
+        Tree::iterator it = tree.insertInterval(start, end, (int) intervals.size());
+        assert(it->key == start && it->end == end);
+        intervals.push_back(make_pair(start, end));
+    }
+    assertIntervalQueries(tree, intervals, gen);
+
+    for (int i = 0; i < 1000; i++)
+    {
+        Tree::node* n = tree.search((long long) (gen() % 20000) - 10000);
+        if (n != tree.getSentinel())
         {
-            logStatus(&keyIter, &nodeGenCount, "deletion");
-            lastLog = elTime;
+            intervals[n->data].second = LLONG_MIN;
+            tree.erase(n);
         }
-        
-        keyIter++;
     }
 
-    logStatus(&keyIter, &nodeGenCount, "deletion");
-    
-    end = duration_cast<milliseconds>(system_clock::now().time_since_epoch());
-    elapsed = end - start;
-    double elFinal = duration<double>(elapsed).count();
-    
-    cout << "Total completion time took about " << elFinal << " seconds." << endl;
-    
-    delete [] keysInTree;
-    
-    return 0;
+    long long key;
+    int data;
+    for (int i = 0; i < 100; i++)
+    {
+        assert(tree.popMin(key, data));
+        intervals[data].second = LLONG_MIN;
+    }
+    assertIntervalQueries(tree, intervals, gen);
+
+    Tree right;
+    tree.split(0, right);
+    assertIntervalQueries(right, intervals, gen);
+    tree.join(right);
+    assertIntervalQueries(tree, intervals, gen);
+
+    cout << "Interval tree unit test has been completed." << endl;
+}
+
+/**
+ * Asserts every interval tree node holds the largest end point of its subtree, and that random overlap and stabbing
+ * queries report, in key order, exactly the intervals found by a scan. Intervals removed from the tree have their
+ * end set to LLONG_MIN; the scan only counts intervals whose node is in the tree.
+ * 
+ * @param Tree&
+ * @param vector<pair<long long, long long>>&
+ * @param mt19937_64&
+ * @return void
+ */
+template <class Tree>
+void assertIntervalQueries(Tree& tree, vector<pair<long long, long long>>& intervals, mt19937_64& gen)
+{
+    vector<bool> inTree(intervals.size(), false);
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+    {
+        inTree[it->data] = true;
+
+        long long maxEnd = it->end;
+        if (it->left != tree.getSentinel())
+            maxEnd = max(maxEnd, it->left->maxEnd);
+        if (it->right != tree.getSentinel())
+            maxEnd = max(maxEnd, it->right->maxEnd);
+        assert(it->maxEnd == maxEnd);
+    }
+
+    if (!tree.isEmpty())
+        performRedBlackPropertyAssertion(&tree);
+
+    for (int q = 0; q < 300; q++)
+    {
+        long long lo = (long long) (gen() % 24000) - 12000;
+        long long hi = q % 3 == 0 ? lo : lo + (long long) (gen() % 300);
+
+        vector<int> expected;
+        for (size_t i = 0; i < intervals.size(); i++)
+            if (inTree[i] && intervals[i].first <= hi && intervals[i].second >= lo)
+                expected.push_back((int) i);
+
+        vector<int> found;
+        long long last = LLONG_MIN;
+        auto collect = [&](typename Tree::node* n) {
+            assert(n->key >= last);
+            last = n->key;
+            found.push_back(n->data);
+        };
+
+        if (lo == hi)
+            tree.stab(lo, collect);
+        else
+            tree.findOverlapping(lo, hi, collect);
+
+        sort(found.begin(), found.end());
+        assert(found == expected);
+    }
+}
+
+/**
+ * Checks eraseRange and eraseIf against a sorted copy of the keys: expiring prefixes, ranges in the middle, empty
+ * and reversed ranges, ranges covering the whole tree, and predicates matching few nodes (erased one by one) or
+ * many (relinked). The cached ends and the subtree sizes are checked after each step.
+ * 
+ * @return void
+ */
+void eraseUnitTest()
+{
+    cout << "Range erase unit test now being performed." << endl;
+
+    typedef RBTree<unsigned long long, int, less<unsigned long long>, rbNodePool, rbOrderStatistic> Tree;
+
+    mt19937_64 gen(43);
+    Tree tree;
+    vector<unsigned long long> keys;
+
+    assert(tree.eraseRange(0, 100) == 0 && tree.eraseIf([](Tree::node*) { return true; }) == 0);
+
+    for (int round = 0; round < 40; round++)
+    {
+        for (int i = 0; i < 2000; i++)
+        {
+            unsigned long long key = gen() % 10000;
+            tree.insert(key, 0);
+            keys.insert(upper_bound(keys.begin(), keys.end(), key), key);
+        }
+
+        unsigned long long lo = gen() % 10000;
+        unsigned long long hi = round % 4 == 0 ? lo : lo + gen() % 3000;
+        if (round % 5 == 0)
+            lo = 0;
+
+        vector<unsigned long long>::iterator first = lower_bound(keys.begin(), keys.end(), lo);
+        vector<unsigned long long>::iterator last = lower_bound(keys.begin(), keys.end(), max(lo, hi));
+        size_t count = last - first;
+        keys.erase(first, last);
+
+        assert(tree.eraseRange(lo, hi) == count);
+        assert(tree.eraseRange(hi, lo) == 0);
+        assertTreeHolds(tree, keys);
+        assert(tree.isEmpty() || (tree.peekMin()->key == keys.front() && tree.peekMax()->key == keys.back()));
+    }
+
+    // a handful of matches takes the one by one path, every other key the relinking path
+    unsigned long long divisors[] = {997, 2};
+    for (unsigned long long d : divisors)
+    {
+        auto matches = [d](unsigned long long key) { return key % d == 0; };
+        size_t count = count_if(keys.begin(), keys.end(), matches);
+        keys.erase(remove_if(keys.begin(), keys.end(), matches), keys.end());
+
+        assert(tree.eraseIf([&](Tree::node* n) { return matches(n->key); }) == count);
+        assertTreeHolds(tree, keys);
+        assert(tree.peekMin()->key == keys.front() && tree.peekMax()->key == keys.back());
+    }
+
+    tree.insert(20000, 0);
+    tree.append(20001, 0);
+    keys.push_back(20000);
+    keys.push_back(20001);
+    assertTreeHolds(tree, keys);
+
+    assert(tree.eraseRange(0, 30000) == keys.size() && tree.isEmpty());
+    assert(tree.peekMin() == tree.getSentinel() && tree.peekMax() == tree.getSentinel());
+
+    for (unsigned long long i = 0; i < 100; i++)
+        tree.append(i, 0);
+    assert(tree.eraseIf([](Tree::node*) { return true; }) == 100 && tree.isEmpty());
+
+    cout << "Range erase unit test has been completed." << endl;
+}
+
+/**
+ * Asserts the tree holds exactly the sorted keys, keeps correct subtree sizes and satisfies the red black
+ * properties.
+ * 
+ * @param Tree&
+ * @param vector<unsigned long long>&
+ * @return void
+ */
+template <class Tree>
+void assertTreeHolds(Tree& tree, vector<unsigned long long>& keys)
+{
+    assert(tree.size() == keys.size());
+    assert(checkSubtreeSizes(tree.getRoot(), tree.getSentinel()) == keys.size());
+
+    size_t idx = 0;
+    for (typename Tree::iterator it = tree.begin(); it != tree.end(); ++it)
+        assert(it->key == keys[idx++]);
+    assert(idx == keys.size());
+
+    if (!tree.isEmpty())
+        performRedBlackPropertyAssertion(&tree);
+}
+
+/**
+ * Recounts every subtree and asserts the stored size of each node matches the recount, returning the number of
+ * nodes below and including root.
+ * 
+ * @param N*
+ * @param N*
+ * @return size_t
+ */
+template <class N>
+size_t checkSubtreeSizes(N* root, N* sentinel)
+{
+    if (root == sentinel)
+        return 0;
+
+    size_t count = checkSubtreeSizes(root->left, sentinel) + checkSubtreeSizes(root->right, sentinel) + 1;
+    assert(root->size == count);
+    return count;
 }
 
 /**
  * Returns true if node 'n' has the color BLACK, and false if RED.
  * 
- * @param rbNode<T>*
+ * @param N*
  * @return bool
  */
-template <class T>
-bool isBlack(rbNode<T>* n)
+template <class N>
+bool isBlack(N* n)
 {
     if (n->rbColor == BLACK)
         return true;
@@ -143,8 +1641,8 @@ bool isBlack(rbNode<T>* n)
   * @param RBT<T>
   * @return void
   */
-template <class T>
-void performRedBlackPropertyAssertion(RBT<T>* tree)
+template <class Tree>
+void performRedBlackPropertyAssertion(Tree* tree)
 {
     // Property 1: Every node is either red or black
     assert(true == allRedOrBlack(tree->getRoot(), tree->getSentinel()));
@@ -166,12 +1664,12 @@ void performRedBlackPropertyAssertion(RBT<T>* tree)
 /**
  * Returns true if every node in the tree is RED or BLACK an false otherwise.
  * 
- * @param rbNode<T>*
- * @param rbNode<T>*
+ * @param N*
+ * @param N*
  * @return bool
  */
-template <class T>
-bool allRedOrBlack(rbNode<T>* root, rbNode<T>* sentinel)
+template <class N>
+bool allRedOrBlack(N* root, N* sentinel)
 {
     bool allCorrect = true;
 
@@ -196,27 +1694,27 @@ bool allRedOrBlack(rbNode<T>* root, rbNode<T>* sentinel)
  * be any adjacent red nodes in the red black tree in order to keep the same 
  * number of black nodes in all simple paths.
  * 
- * @param rbNode<T>*
- * @param rbNode<T>*
+ * @param N*
+ * @param N*
  * @return bool
  */
-template <class T>
-bool redHasBlackChildren(rbNode<T>* root, rbNode<T>* sentinel)
+template <class N>
+bool redHasBlackChildren(N* root, N* sentinel)
 {
     bool allCorrect = true;
 
     if (root == sentinel && sentinel->rbColor == BLACK)
         return true;
     
-    allCorrect = allRedOrBlack(root->left, sentinel);
+    allCorrect = redHasBlackChildren(root->left, sentinel);
     
     if (!allCorrect)
         return allCorrect;
     
-    if (root->rbColor == RED && root->left->rbColor != BLACK && root->right->rbColor != BLACK)
+    if (root->rbColor == RED && (root->left->rbColor != BLACK || root->right->rbColor != BLACK))
         return false;
         
-    return allRedOrBlack(root->right, sentinel);
+    return redHasBlackChildren(root->right, sentinel);
 }
 
 /**
@@ -239,13 +1737,13 @@ void logStatus(unsigned long long* currIter, unsigned long long* treeSize, strin
  * as this confirms every simple path has the same amount of black nodes. This will return true
  * if correct and false if any path has an incorrect black node count that doesn't match the rest.
  * 
- * @param rbNode<T>*
- * @param rbNode<T>*
+ * @param N*
+ * @param N*
  * @param int*
  * @return bool 
  */
-template <class T>
-bool allSimplePathsHaveSameBlackNodeCount(rbNode<T>* root, rbNode<T>* sentinel)
+template <class N>
+bool allSimplePathsHaveSameBlackNodeCount(N* root, N* sentinel)
 {
     bool sameCount = true;
     vector<int> pathsBlackNodesCounts;
@@ -275,16 +1773,16 @@ bool allSimplePathsHaveSameBlackNodeCount(rbNode<T>* root, rbNode<T>* sentinel)
  * Naviagates through every simple path until the path can no longer be exhausted and stores the current count of that 
  * recursive instance of black node counts into the blackLens vector reference.
  * 
- * @param rbNode<T>*
- * @param rbNode<T>* 
+ * @param N*
+ * @param N* 
  * @param vector<int>&
  * @param int[]
  * @param int
  * @param int
  * @return void
  */
-template <class T>
-void getSimplePathBlackCounts(rbNode<T>* root, rbNode<T>* sentinel, vector<int>& blackLens, int pathLen, int blackLen)
+template <class N>
+void getSimplePathBlackCounts(N* root, N* sentinel, vector<int>& blackLens, int pathLen, int blackLen)
 {
     if (root == sentinel)  
         return;